@@ -1,76 +1,286 @@
 #include "ED.h"
 #include "EDColor.h"
 #include <fstream>
+#include <unordered_map>
 
 using namespace cv;
 using namespace std;
 
-ED::ED(Mat _srcImage, GradientOperator _op, int _gradThresh, int _anchorThresh,int _scanInterval, int _minPathLen ,double _sigma, bool _sumFlag)
+ED::ED(Mat _srcImage, GradientOperator _op, double _gradThresh, double _anchorThresh,int _scanInterval, int _minPathLen ,double _sigma, bool _sumFlag, EDWorkspace *_workspace)
 {	
 	// Check parameters for sanity
-	if (_gradThresh < 1) _gradThresh = 1;
+	if (_gradThresh < 0) _gradThresh = 0; // at least 1 on the gradient map (see MapThreshold)
 	if (_anchorThresh < 0) _anchorThresh = 0;
 	if (_sigma < 1.0) _sigma = 1.0;
 
 	srcImage = _srcImage;
-
-	height = srcImage.rows;
-	width = srcImage.cols;
 	
 	op = _op;
-	gradThresh = _gradThresh;
-	anchorThresh = _anchorThresh;
+	userGradThresh = _gradThresh;
+	userAnchorThresh = _anchorThresh;
 	scanInterval = _scanInterval;
 	minPathLen = _minPathLen;
 	sigma = _sigma;
 	sumFlag = _sumFlag;
+	InitOptions();
+	workspace = _workspace;
+
+	DetectEdges();
+}
+
+ED::ED(Mat _srcImage, const EDRegions &_regions, GradientOperator _op, double _gradThresh, double _anchorThresh, int _scanInterval, int _minPathLen, double _sigma, bool _sumFlag, EDWorkspace *_workspace)
+{
+	// Check parameters for sanity
+	if (_gradThresh < 0) _gradThresh = 0; // at least 1 on the gradient map (see MapThreshold)
+	if (_anchorThresh < 0) _anchorThresh = 0;
+	if (_sigma < 1.0) _sigma = 1.0;
+
+	srcImage = _srcImage;
+
+	op = _op;
+	userGradThresh = _gradThresh;
+	userAnchorThresh = _anchorThresh;
+	scanInterval = _scanInterval;
+	minPathLen = _minPathLen;
+	sigma = _sigma;
+	sumFlag = _sumFlag;
+	InitOptions();
+	workspace = _workspace;
+	regions = _regions;
+
+	DetectEdges();
+}
+
+// Runs the whole Edge Drawing pipeline on srcImage with the current parameters.
+// If a workspace is attached, the edge, smooth & gradient images and all scratch buffers come from it,
+// so they are only valid until the next detection that uses the same workspace.
+void ED::DetectEdges()
+{
+	height = srcImage.rows;
+	width = srcImage.cols;
 
 	segmentNos = 0;
-	segmentPoints.push_back(vector<Point>()); // create empty vector of points for segments
+	segmentPoints.clear();
+	chainCodes.clear();
+	anchorPoints.clear();
 
-	edgeImage = Mat(height, width, CV_8UC1, Scalar(0)); // initialize edge Image
-	smoothImage = Mat(height, width, CV_8UC1);
-	gradImage = Mat(height, width, CV_16SC1); // gradImage contains short values 
+	EDWorkspace localWorkspace; // used only if no workspace is attached; released on return
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
 
-	srcImg = srcImage.data;
+	int depth = srcImage.depth();
+	CV_Assert(srcImage.channels() == 1 && (depth == CV_8U || depth == CV_16U || depth == CV_32F));
+
+	// 16-bit & float images use the scalar kernels & are not fused (see setFusedPipeline)
+	bool highDepth = depth != CV_8U;
+	bool fused = fusedPipeline && height > 4 && regions.empty() && !highDepth;
+
+	AllocateImages(ws, fused);
+
+	if (segmentSink) segmentSink->begin(width, height);
+
+	// Gradients of 16-bit & float images are scaled into the gradient map, and so are the thresholds
+	gradScale = highDepth ? ComputeGradScale() : 1.0f;
+	gradThresh = MapThreshold(userGradThresh, 1);
+	anchorThresh = MapThreshold(userAnchorThresh, 0);
 
 	//// Detect Edges By Edge Drawing Algorithm  ////
-	
-	/*------------ SMOOTH THE IMAGE BY A GAUSSIAN KERNEL -------------------*/
-	if (sigma == 1.0)
-		GaussianBlur(srcImage, smoothImage, Size(5, 5), sigma);
+
+	regionRects.clear();
+	if (!regions.empty()) {
+		/*------------ SMOOTH, COMPUTE GRADIENT & ANCHORS INSIDE THE REGIONS ONLY -------------------*/
+		DetectEdgesInRegions();
+	}
+	else if (threadPool && threadPool->get_workers_num() > 1 && height > 4) {
+		/*------------ SMOOTH THE IMAGE BY A GAUSSIAN KERNEL (unless fused) -------------------*/
+		if (!fused) {
+			if (sigma == 1.0)
+				GaussianBlur(srcImage, smoothImage, Size(5, 5), sigma);
+			else
+				GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+		} //end-if
+
+		/*------------ COMPUTE GRADIENT & ANCHORS BAND-PARALLEL -------------------*/
+		ComputeGradientAndAnchorsParallel(ws, fused);
+	}
+	else if (fused) {
+		/*------------ SMOOTH, COMPUTE GRADIENT & ANCHORS BAND BY BAND -------------------*/
+		ComputeGradientAndAnchorsByBands(ws);
+	}
+	else {
+		/*------------ SMOOTH THE IMAGE BY A GAUSSIAN KERNEL -------------------*/
+		if (sigma == 1.0)
+			GaussianBlur(srcImage, smoothImage, Size(5, 5), sigma);
+		else
+			GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+
+		/*------------ COMPUTE GRADIENT & EDGE DIRECTION MAPS -------------------*/
+		ComputeGradient();
+
+		/*------------ COMPUTE ANCHORS -------------------*/
+		ComputeAnchorPoints();
+	} //end-else
+
+	smoothedInFull = regions.empty() ? !fused : presmoothed;
+
+	// Segments kept from an earlier frame are already drawn: walks stop at them and their anchors are taken
+	if (keptSegments) {
+		const Point *p = keptSegments->data();
+		for (int k = 0; k < keptSegments->totalPoints(); k++) edgeImg[p[k].y*width + p[k].x] = EDGE_PIXEL;
+	} //end-if
+
+	/*------------ JOIN ANCHORS -------------------*/
+	if (tiledLinking)
+		JoinAnchorPointsByTiles(ws);
 	else
-		GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+		JoinAnchorPointsUsingSortedAnchors(ws);
+
+	if (keptSegments) {
+		EDSegments segments;
+		segments.reserve(keptSegments->totalPoints() + segmentPoints.totalPoints(), keptSegments->size() + segmentNos);
+		for (int k = 0; k < keptSegments->size(); k++) segments.append((*keptSegments)[k]);
+		for (int k = 0; k < segmentNos; k++) segments.append(segmentPoints[k]);
+
+		segmentPoints = std::move(segments);
+		segmentNos = segmentPoints.size();
+	} //end-if
+
+	if (segmentSink) {
+		// Serial linking streamed its segments already; tiled ones are only final once stitched,
+		// new ones of an incremental frame once listed after the kept ones
+		if (tiledLinking || keptSegments)
+			for (int k = 0; k < segmentNos; k++) segmentSink->segment(k, segmentPoints[k]);
+
+		segmentSink->end(segmentNos);
+	} //end-if
+}
+
+// Edge, gradient, direction & (unless fused) smoothed images of srcImage, from ws if a workspace is attached
+void ED::AllocateImages(EDWorkspace *ws, bool fused)
+{
+	if (workspace) {
+		edgeImage = Mat(height, width, CV_8UC1, ws->getEdgeImg(width*height));
+		gradImage = Mat(height, width, CV_16SC1, ws->getGradImg(width*height));
+		if (!fused) smoothImage = Mat(height, width, srcImage.type(), ws->getSmoothImg(width*height*(int)srcImage.elemSize()));
+		edgeImage.setTo(Scalar(0)); // initialize edge Image
+	}
+	else {
+		edgeImage = Mat(height, width, CV_8UC1, Scalar(0)); // initialize edge Image
+		gradImage = Mat(height, width, CV_16SC1); // gradImage contains short values 
+		if (!fused) smoothImage = Mat(height, width, srcImage.type());
+	} //end-else
+
+	if (fused) smoothImage = Mat(); // the fused pipeline does not keep the smoothed image
+
+	srcImg = srcImage.data;
 
 	// Assign Pointers from Mat's data
 	smoothImg = smoothImage.data;
 	gradImg = (short*)gradImage.data;
 	edgeImg = edgeImage.data;
 
-	dirImg = new unsigned char[width*height];
+	dirImg = ws->getDirImg(width*height);
+}
 
-	/*------------ COMPUTE GRADIENT & EDGE DIRECTION MAPS -------------------*/
+//-----------------------------------------------------------------------------------------
+// Parameter sweep (see EDDetector::sweep).
+// Smoothing & gradient do not depend on the thresholds, so they are computed once, with the direction of every
+// pixel (as for gradThresh 1) and zero borders. Each parameter set then only extracts anchors & links them on
+// these read-only maps, which gives the same segments as a separate detection with that set.
+//
+vector<EDSegments> ED::DetectSweep(const vector<EDSweepParams> &params)
+{
+	height = srcImage.rows;
+	width = srcImage.cols;
+
+	int depth = srcImage.depth();
+	CV_Assert(srcImage.channels() == 1 && (depth == CV_8U || depth == CV_16U || depth == CV_32F));
+
+	segmentNos = 0;
+	segmentPoints.clear();
+	chainCodes.clear();
+	anchorPoints.clear();
+	anchorNos = 0;
+
+	EDWorkspace localWorkspace; // used only if no workspace is attached; released on return
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
+
+	AllocateImages(ws, false);
+
+	/*------------ SMOOTH THE IMAGE BY A GAUSSIAN KERNEL -------------------*/
+	if (sigma == 1.0)
+		GaussianBlur(srcImage, smoothImage, Size(5, 5), sigma);
+	else
+		GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+
+	smoothedInFull = true;
+
+	/*------------ COMPUTE GRADIENT & EDGE DIRECTION MAPS FOR ALL THRESHOLDS -------------------*/
+	gradScale = depth == CV_8U ? 1.0f : ComputeGradScale();
+
+	gradThresh = 1;
 	ComputeGradient();
 
-	/*------------ COMPUTE ANCHORS -------------------*/
-	ComputeAnchorPoints();
+	/*------------ ANCHORS & LINKING PER PARAMETER SET -------------------*/
+	vector<EDSegments> results(params.size());
+	auto detect = [this, &params, &results](int k) {
+		const EDSweepParams &p = params[k];
+		int setGradThresh = MapThreshold(p.gradThresh, 1);
+		int setAnchorThresh = MapThreshold(p.anchorThresh, 0);
 
-	/*------------ JOIN ANCHORS -------------------*/
-	JoinAnchorPointsUsingSortedAnchors();
-	
-	delete[] dirImg;
+		ED ed(gradImg, dirImg, width, height, setGradThresh, setAnchorThresh, MAX(p.scanInterval, 1), p.minPathLen, false);
+		results[k] = ed.takeSegments();
+	};
+
+	if (threadPool && threadPool->get_workers_num() > 1 && params.size() > 1) {
+		vector<std::future<void>> futures;
+		futures.reserve(params.size());
+		for (int k = 0; k < (int)params.size(); k++) futures.push_back(threadPool->enqueue([&detect, k] { detect(k); }));
+		WaitForTasks(futures);
+	}
+	else {
+		for (int k = 0; k < (int)params.size(); k++) detect(k);
+	} //end-else
+
+	return results;
 }
 
 // This constructor for use of EDLines and EDCircle with ED given as constructor argument
 // only the necessary attributes are coppied
 ED::ED(const ED & cpyObj)
+{
+	ShareResults(cpyObj);
+
+	segmentPoints = cpyObj.segmentPoints;
+	chainCodes = cpyObj.chainCodes;
+	segmentNos = cpyObj.segmentNos;
+}
+
+// Same, but the segments are moved out of cpyObj (which is left with no segments)
+ED::ED(ED &&cpyObj)
+{
+	ShareResults(cpyObj);
+
+	segmentPoints = std::move(cpyObj.segmentPoints);
+	chainCodes = std::move(cpyObj.chainCodes);
+	segmentNos = cpyObj.segmentNos;
+	cpyObj.segmentPoints = EDSegments();
+	cpyObj.chainCodes = EDChainCodes();
+	cpyObj.segmentNos = 0;
+}
+
+// Takes over the parameters & images of cpyObj. Images are shared, not copied (cv::Mat is reference counted);
+// those of an ED that works in a workspace (e.g. EDDetector) are borrowed and only valid until its next detection.
+// Stages that rewrite an image (EDPF's edge map & smoothing) give themselves a new one first.
+void ED::ShareResults(const ED &cpyObj)
 {
 	height = cpyObj.height;
 	width = cpyObj.width;
 
-	srcImage = cpyObj.srcImage.clone();
+	srcImage = cpyObj.srcImage;
 	
 	op = cpyObj.op;
+	userGradThresh = cpyObj.userGradThresh;
+	userAnchorThresh = cpyObj.userAnchorThresh;
 	gradThresh = cpyObj.gradThresh;
 	anchorThresh = cpyObj.anchorThresh;
 	scanInterval = cpyObj.scanInterval;
@@ -78,18 +288,40 @@ ED::ED(const ED & cpyObj)
 	sigma = cpyObj.sigma;
 	sumFlag = cpyObj.sumFlag;
 
-	edgeImage = cpyObj.edgeImage.clone();
-	smoothImage = cpyObj.smoothImage.clone();
-	gradImage = cpyObj.gradImage.clone();
+	edgeImage = cpyObj.edgeImage;
+	smoothImage = cpyObj.smoothImage;
+	gradImage = cpyObj.gradImage;
 
 	srcImg = srcImage.data;
 
 	smoothImg = smoothImage.data;
 	gradImg = (short*)gradImage.data;
 	edgeImg = edgeImage.data;
+	gradScale = cpyObj.gradScale;
+
+	workspace = cpyObj.workspace;
+	fusedPipeline = cpyObj.fusedPipeline;
+	bandHeight = cpyObj.bandHeight;
+	threadPool = cpyObj.threadPool;
+	tiledLinking = cpyObj.tiledLinking;
+	tileSize = cpyObj.tileSize;
+	tileSides = 0;
+	tileStats = cpyObj.tileStats;
+	maxLinkMemory = cpyObj.maxLinkMemory;
+	noTruncatedWalks = cpyObj.noTruncatedWalks;
+	regions = cpyObj.regions;
+	regionRects = cpyObj.regionRects;
+	presmoothed = false;
+	smoothedInFull = cpyObj.smoothedInFull;
+	keptSegments = NULL;
+	segmentSink = NULL;
+}
 
-	segmentPoints = cpyObj.segmentPoints;
-	segmentNos = cpyObj.segmentNos;
+// Starts a new, cleared edge map instead of overwriting the one that may be shared with another ED
+void ED::DetachEdgeImage()
+{
+	edgeImage = Mat(height, width, CV_8UC1, Scalar(0));
+	edgeImg = edgeImage.data;
 }
 
 // This constructor for use of EDColor with use of direction and gradient image
@@ -101,11 +333,14 @@ ED::ED(short *_gradImg, uchar *_dirImg, int _width, int _height, int _gradThresh
 
 	gradThresh = _gradThresh;
 	anchorThresh = _anchorThresh;
+	userGradThresh = _gradThresh; // the maps are given, so thresholds are in map units
+	userAnchorThresh = _anchorThresh;
 	scanInterval = _scanInterval;
 	minPathLen = _minPathLen;
 
 	gradImg = _gradImg;
 	dirImg = _dirImg;
+	InitOptions();
 
 	edgeImage = Mat(height, width, CV_8UC1, Scalar(0)); // initialize edge Image
 
@@ -180,22 +415,46 @@ ED::ED(short *_gradImg, uchar *_dirImg, int _width, int _height, int _gradThresh
 	} //end-else
 
 	segmentNos = 0;
-	segmentPoints.push_back(vector<Point>()); // create empty vector of points for segments
+	segmentPoints.clear();
 
-	JoinAnchorPointsUsingSortedAnchors();
+	EDWorkspace localWorkspace;
+	JoinAnchorPointsUsingSortedAnchors(&localWorkspace);
 }
 
 ED::ED(EDColor &obj) 
 {
 	width = obj.getWidth();
 	height = obj.getHeight();
-	segmentPoints = obj.getSegments();
+	segmentPoints.assign(obj.getSegments());
 	segmentNos = obj.getSegmentNo();
+	InitOptions();
 }
 
 ED::ED()
 {
-	//
+	InitOptions();
+}
+
+// Default pipeline options: plain serial ED on buffers allocated per call
+void ED::InitOptions()
+{
+	workspace = NULL;
+	fusedPipeline = false;
+	bandHeight = 0;
+	threadPool = NULL;
+	tiledLinking = false;
+	tileSize = 0;
+	tileSides = 0;
+	memset(&tileStats, 0, sizeof(tileStats));
+	maxLinkMemory = 0;
+	noTruncatedWalks = 0;
+	regions = EDRegions();
+	regionRects.clear();
+	presmoothed = false;
+	smoothedInFull = false;
+	keptSegments = NULL;
+	gradScale = 1.0f;
+	segmentSink = NULL;
 }
 
 
@@ -229,6 +488,11 @@ Mat ED::getGradImage()
 	return result8UC1;
 }
 
+float ED::getGradScale()
+{
+	return gradScale;
+}
+
 int ED::getSegmentNo()
 {
 	return segmentNos;
@@ -239,29 +503,53 @@ int ED::getAnchorNo()
 	return anchorNos;
 }
 
-std::vector<Point> ED::getAnchorPoints()
+const std::vector<Point> & ED::getAnchorPoints()
 {
 	return anchorPoints;
 }
 
 std::vector<std::vector<Point>> ED::getSegments()
 {
-	return segmentPoints;
+	return segmentPoints.toVectors();
 }
 
 std::vector<std::vector<Point>> ED::getSortedSegments()
 {
 		// sort segments from largest to smallest
-		std::sort(segmentPoints.begin(), segmentPoints.end(), [](const std::vector<Point> & a, const std::vector<Point> & b) { return a.size() > b.size(); });
+		std::vector<std::vector<Point>> segments = segmentPoints.toVectors();
+		std::sort(segments.begin(), segments.end(), [](const std::vector<Point> & a, const std::vector<Point> & b) { return a.size() > b.size(); });
+
+		segmentPoints.assign(segments); // segment numbers follow the sorted order from now on
+		return segments;
+}
 
-		return segmentPoints;
+const EDSegments & ED::getSegmentList()
+{
+	return segmentPoints;
+}
+
+EDSegments ED::takeSegments()
+{
+	EDSegments segments = std::move(segmentPoints);
+	segmentPoints = EDSegments();
+	segmentNos = 0;
+	chainCodes.clear();
+
+	return segments;
+}
+
+const EDChainCodes &ED::getChainCodes()
+{
+	if (chainCodes.empty() && !segmentPoints.empty()) chainCodes.assign(segmentPoints);
+
+	return chainCodes;
 }
 
 Mat ED::drawParticularSegments(std::vector<int> list)
 {
 	Mat segmentsImage = Mat(edgeImage.size(), edgeImage.type(), Scalar(0));
 
-	std::vector<Point>::iterator it;
+	const Point *it;
 	std::vector<int>::iterator itInt;
 
 	for (itInt = list.begin(); itInt != list.end(); itInt++)
@@ -274,102 +562,84 @@ Mat ED::drawParticularSegments(std::vector<int> list)
 
 void ED::ComputeGradient()
 {	
-	// Initialize gradient image for row = 0, row = height-1, column=0, column=width-1 
-	for (int j = 0; j<width; j++) { gradImg[j] = gradImg[(height - 1)*width + j] = gradThresh - 1; }
-	for (int i = 1; i<height - 1; i++) { gradImg[i*width] = gradImg[(i + 1)*width - 1] = gradThresh - 1; }
-
-	for (int i = 1; i<height - 1; i++) {
-		for (int j = 1; j<width - 1; j++) {
-			// Prewitt Operator in horizontal and vertical direction
-			// A B C
-			// D x E
-			// F G H
-			// gx = (C-A) + (E-D) + (H-F)
-			// gy = (F-A) + (G-B) + (H-C)
-			//
-			// To make this faster: 
-			// com1 = (H-A)
-			// com2 = (C-F)
-			// 
-			// For Prewitt
-			// Then: gx = com1 + com2 + (E-D) = (H-A) + (C-F) + (E-D) = (C-A) + (E-D) + (H-F)
-			//       gy = com1 - com2 + (G-B) = (H-A) - (C-F) + (G-B) = (F-A) + (G-B) + (H-C)
-			// 
-			// For Sobel
-			// Then: gx = com1 + com2 + 2*(E-D) = (H-A) + (C-F) + 2*(E-D) = (C-A) + 2*(E-D) + (H-F)
-			//       gy = com1 - com2 + 2*(G-B) = (H-A) - (C-F) + 2*(G-B) = (F-A) + 2*(G-B) + (H-C)
-			//
-			// For Scharr
-			// Then: gx = 3*(com1 + com2) + 10*(E-D) = 3*(H-A) + 3*(C-F) + 10*(E-D) = 3*(C-A) + 10*(E-D) + 3*(H-F)
-			//       gy = 3*(com1 - com2) + 10*(G-B) = 3*(H-A) - 3*(C-F) + 10*(G-B) = 3*(F-A) + 10*(G-B) + 3*(H-C)
-			//
-			// For LSD
-			// A B
-			// C D
-			// gx = (B-A) + (D-C)
-			// gy = (C-A) + (D-B)
-			//
-			// To make this faster: 
-			// com1 = (D-A)
-			// com2 = (B-C)
-			// Then: gx = com1 + com2 = (D-A) + (B-C) = (B-A) + (D-C)
-			//       gy = com1 - com2 = (D-A) - (B-C) = (C-A) + (D-B)
-
-			int com1 = smoothImg[(i + 1)*width + j + 1] - smoothImg[(i - 1)*width + j - 1];
-			int com2 = smoothImg[(i - 1)*width + j + 1] - smoothImg[(i + 1)*width + j - 1];
-
-			int gx;
-			int gy;
-			
-			switch (op)
-			{
-			case PREWITT_OPERATOR:
-				gx = abs(com1 + com2 + (smoothImg[i*width + j + 1] - smoothImg[i*width + j - 1]));
-				gy = abs(com1 - com2 + (smoothImg[(i + 1)*width + j] - smoothImg[(i - 1)*width + j]));
-				break;
-			case SOBEL_OPERATOR:
-				gx = abs(com1 + com2 + 2 * (smoothImg[i*width + j + 1] - smoothImg[i*width + j - 1]));
-				gy = abs(com1 - com2 + 2 * (smoothImg[(i + 1)*width + j] - smoothImg[(i - 1)*width + j]));
-				break;
-			case SCHARR_OPERATOR:
-				gx = abs(3 * (com1 + com2) + 10 * (smoothImg[i*width + j + 1] - smoothImg[i*width + j - 1]));
-				gy = abs(3 * (com1 - com2) + 10 * (smoothImg[(i + 1)*width + j] - smoothImg[(i - 1)*width + j]));
-			case LSD_OPERATOR:
-				// com1 and com2 differs from previous operators, because LSD has 2x2 kernel
-				int com1 = smoothImg[(i + 1)*width + j + 1] - smoothImg[i*width + j];
-				int com2 = smoothImg[i*width + j + 1] - smoothImg[(i + 1)*width + j];
-
-				gx = abs(com1 + com2);
-				gy = abs(com1 - com2);
-			}
-			
-			int sum;
+	InitGradientBorders();
 
-			if(sumFlag)
-				sum = gx + gy;
-			else
-				sum = (int)sqrt((double)gx*gx + gy*gy);
+	ComputeGradientRect(1, height - 2);
+}
 
-			int index = i*width + j;
-			gradImg[index] = sum;
+// Gradient & direction of noRows rows from row on, columns [colStart, colEnd) (colEnd < 0: all but the border column)
+void ED::ComputeGradientRect(int row, int noRows, int colStart, int colEnd)
+{
+	int offset = row*width;
+
+	// Operator-specific (vectorized where available) kernels, see EDGradient.h
+	switch (smoothImage.depth()) {
+	case CV_16U:
+		ComputeGradientRowsScaled(op, sumFlag, (const ushort *)smoothImg + offset, gradImg + offset, dirImg + offset, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		break;
+	case CV_32F:
+		ComputeGradientRowsScaled(op, sumFlag, (const float *)smoothImg + offset, gradImg + offset, dirImg + offset, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		break;
+	default:
+		ComputeGradientRows(op, sumFlag, smoothImg + offset, gradImg + offset, dirImg + offset, width, gradThresh, noRows, colStart, colEnd);
+	} //end-switch
+}
 
-			if (sum >= gradThresh) {
-				if (gx >= gy) dirImg[index] = EDGE_VERTICAL;
-				else          dirImg[index] = EDGE_HORIZONTAL;
-			} //end-if
-		} // end-for
-	} // end-for
+// Largest power of two that keeps the gradients of a 16-bit or float srcImage within the 16-bit gradient map.
+// Smoothing does not widen the pixel range, so the range of srcImage bounds the gradients.
+// The scale is 1 or more (no loss) unless MaxGradient of the range exceeds SHRT_MAX (see ED.h).
+float ED::ComputeGradScale()
+{
+	double minVal, maxVal;
+	minMaxLoc(srcImage, &minVal, &maxVal);
+
+	double maxGrad = MaxGradient(op, maxVal - minVal);
+	float scale = 1.0f;
+	if (maxGrad > 0) {
+		while (maxGrad*scale > SHRT_MAX) scale /= 2;
+		while (maxGrad*scale * 2 <= SHRT_MAX) scale *= 2;
+	} //end-if
+
+	return scale;
+}
+
+// A threshold in gradient units of the input as a threshold on the gradient map (a pixel passes if its value is >= it),
+// at least minThresh. Scaled gradients saturate at SHRT_MAX, so a threshold above the map's range is clamped to it.
+int ED::MapThreshold(double thresh, int minThresh)
+{
+	double t = ceil(thresh*gradScale);
+	return (int)MIN(MAX(t, (double)minThresh), (double)SHRT_MAX);
+}
+
+// Initialize gradient image for row = 0, row = height-1, column=0, column=width-1 
+void ED::InitGradientBorders()
+{
+	short below = (short)(MIN(gradThresh, SHRT_MAX) - 1); // below the threshold (which may be given in map units)
+	for (int j = 0; j<width; j++) { gradImg[j] = gradImg[(height - 1)*width + j] = below; }
+	for (int i = 1; i<height - 1; i++) { gradImg[i*width] = gradImg[(i + 1)*width - 1] = below; }
 }
 
 void ED::ComputeAnchorPoints()
 {
 	//memset(edgeImg, 0, width*height);
-	for (int i = 2; i<height - 2; i++) {
-		int start = 2;
+	ComputeAnchorRows(2, height - 2, anchorPoints);
+
+	anchorNos = (int)anchorPoints.size(); // get the total number of anchor points
+}
+
+// Marks anchors in rows [rowStart, rowEnd) and columns [colStart, colEnd) (by default all but the two border columns
+// on either side) and appends them to anchors in scan order.
+// Needs the gradient of rows rowStart-1 ... rowEnd and columns colStart-1 ... colEnd.
+void ED::ComputeAnchorRows(int rowStart, int rowEnd, vector<Point> &anchors, int colStart, int colEnd)
+{
+	if (colEnd < 0) colEnd = width - 2;
+
+	for (int i = rowStart; i<rowEnd; i++) {
+		int start = colStart;
 		int inc = 1;
-		if (i%scanInterval != 0) { start = scanInterval; inc = scanInterval; }
+		if (i%scanInterval != 0) { start = MAX(scanInterval, (colStart + scanInterval - 1) / scanInterval * scanInterval); inc = scanInterval; }
 
-		for (int j = start; j<width - 2; j += inc) {
+		for (int j = start; j<colEnd; j += inc) {
 			if (gradImg[i*width + j] < gradThresh) continue;
 
 			if (dirImg[i*width + j] == EDGE_VERTICAL) {
@@ -378,7 +648,7 @@ void ED::ComputeAnchorPoints()
 				int diff2 = gradImg[i*width + j] - gradImg[i*width + j + 1];
 				if (diff1 >= anchorThresh && diff2 >= anchorThresh) {
 					edgeImg[i*width + j] = ANCHOR_PIXEL;
-					anchorPoints.push_back(Point(j, i)); 
+					anchors.push_back(Point(j, i));
 				}
 
 			}
@@ -388,25 +658,379 @@ void ED::ComputeAnchorPoints()
 				int diff2 = gradImg[i*width + j] - gradImg[(i + 1)*width + j];
 				if (diff1 >= anchorThresh && diff2 >= anchorThresh) {
 					edgeImg[i*width + j] = ANCHOR_PIXEL;
-					anchorPoints.push_back(Point(j, i)); 
+					anchors.push_back(Point(j, i));
 				}
 			} // end-else
 		} //end-for-inner
 	} //end-for-outer
+}
+
+//-----------------------------------------------------------------------------------------
+// Region restricted detection (see EDRegions).
+// Only the regions (plus the few pixels around them that the kernels need) are smoothed and differentiated,
+// and only their pixels are scanned for anchors. The gradient is zero everywhere else, so walks stop at
+// region borders just like at the image border.
+//
+void ED::DetectEdgesInRegions()
+{
+	ComputeRegionRects();
+
+	// No gradient outside the regions. The smoothed image is left undefined there.
+	memset(gradImg, 0, sizeof(short)*width*height);
+
+	if (presmoothed)
+		smoothImg = smoothImage.data;
+	else if (sigma == 1.0)
+		SmoothRegions(Size(5, 5), sigma, 2);
+	else
+		SmoothRegions(Size(), sigma, 2); // calculate kernel from sigma
+
+	// Gradient of the regions grown by one pixel, so that anchors on a region border are compared with
+	// their true neighbours rather than with the zero gradient outside
+	Rect inner(1, 1, width - 2, height - 2);
+	for (size_t k = 0; k < regionRects.size(); k++) {
+		Rect r = regionRects[k];
+		Rect g = Rect(r.x - 1, r.y - 1, r.width + 2, r.height + 2) & inner;
+		if (g.empty()) continue;
+
+		ComputeGradientRect(g.y, g.height, g.x, g.x + g.width);
+	} //end-for
+
+	Rect anchorArea(2, 2, width - 4, height - 4);
+	for (size_t k = 0; k < regionRects.size(); k++) {
+		Rect a = regionRects[k] & anchorArea;
+		if (a.empty()) continue;
+
+		ComputeAnchorRows(a.y, a.y + a.height, anchorPoints, a.x, a.x + a.width);
+	} //end-for
+
+	if (!regions.mask.empty()) {
+		// drop the anchors outside the mask
+		int noAnchors = 0;
+		for (size_t k = 0; k < anchorPoints.size(); k++) {
+			Point p = anchorPoints[k];
+			if (regions.mask.at<uchar>(p.y, p.x)) anchorPoints[noAnchors++] = p;
+			else                                  edgeImg[p.y*width + p.x] = 0;
+		} //end-for
+		anchorPoints.resize(noAnchors);
+	} //end-if
+
+	anchorNos = (int)anchorPoints.size(); // get the total number of anchor points
+
+	// Wall off the region borders (the pixel ring computed above) & the masked-out pixels for linking
+	Rect image(0, 0, width, height);
+	for (size_t k = 0; k < regionRects.size(); k++) {
+		Rect r = regionRects[k];
+		Rect g = Rect(r.x - 1, r.y - 1, r.width + 2, r.height + 2) & image;
+
+		for (int i = g.y; i < g.y + g.height; i++) {
+			bool ringRow = i < r.y || i >= r.y + r.height;
+			for (int j = g.x; j < g.x + g.width; j++) {
+				if (!ringRow && j >= r.x && j < r.x + r.width) {
+					// inside the rectangle: only the mask matters
+					if (regions.mask.empty()) { j = r.x + r.width - 1; continue; }
+					if (regions.mask.at<uchar>(i, j) == 0) gradImg[i*width + j] = 0;
+					continue;
+				} //end-if
+
+				if (!InRegion(i, j)) gradImg[i*width + j] = 0;
+			} //end-for
+		} //end-for
+	} //end-for
+}
+
+// Turns the regions into disjoint rectangles inside the image, so that no pixel is processed twice.
+// A mask without rectangles is covered band by band of rows, by one rectangle per run of masked columns in the band.
+void ED::ComputeRegionRects()
+{
+	regionRects.clear();
+	Rect image(0, 0, width, height);
+
+	vector<Rect> rects;
+	if (!regions.mask.empty()) CV_Assert(regions.mask.type() == CV_8UC1 && regions.mask.rows == height && regions.mask.cols == width);
+
+	if (!regions.rois.empty()) {
+		for (size_t k = 0; k < regions.rois.size(); k++) {
+			Rect r = regions.rois[k] & image;
+			if (!r.empty()) rects.push_back(r);
+		} //end-for
+	}
+	else {
+		const int BAND = 16;
+		vector<uchar> columns(width);
+		for (int r0 = 0; r0 < height; r0 += BAND) {
+			int r1 = MIN(r0 + BAND, height);
+			int minRow = height, maxRow = -1;
+
+			// masked columns of the band
+			memset(columns.data(), 0, width);
+			for (int i = r0; i < r1; i++) {
+				const uchar *m = regions.mask.ptr<uchar>(i);
+				uchar any = 0;
+				for (int j = 0; j < width; j++) { columns[j] |= m[j]; any |= m[j]; }
+				if (any) { minRow = MIN(minRow, i); maxRow = i; }
+			} //end-for
+			if (maxRow < 0) continue;
+
+			for (int j = 0; j < width; j++) {
+				if (columns[j] == 0) continue;
+
+				int j0 = j;
+				while (j < width && columns[j]) j++;
+				rects.push_back(Rect(j0, minRow, j - j0, maxRow - minRow + 1));
+			} //end-for
+		} //end-for
+	} //end-else
+
+	for (size_t k = 0; k < rects.size(); k++) {
+		// subtract the rectangles taken so far from this one
+		vector<Rect> pieces(1, rects[k]), rest;
+		for (size_t t = 0; t < regionRects.size() && !pieces.empty(); t++) {
+			rest.clear();
+			for (size_t p = 0; p < pieces.size(); p++) {
+				Rect a = pieces[p];
+				Rect c = a & regionRects[t];
+				if (c.empty()) { rest.push_back(a); continue; }
+
+				if (c.y > a.y) rest.push_back(Rect(a.x, a.y, a.width, c.y - a.y)); // above
+				if (c.y + c.height < a.y + a.height) rest.push_back(Rect(a.x, c.y + c.height, a.width, a.y + a.height - c.y - c.height)); // below
+				if (c.x > a.x) rest.push_back(Rect(a.x, c.y, c.x - a.x, c.height)); // left
+				if (c.x + c.width < a.x + a.width) rest.push_back(Rect(c.x + c.width, c.y, a.x + a.width - c.x - c.width, c.height)); // right
+			} //end-for
+			pieces.swap(rest);
+		} //end-for
+
+		regionRects.insert(regionRects.end(), pieces.begin(), pieces.end());
+	} //end-for
+}
+
+// Smooths the region rectangles grown by margin pixels into smoothImage
+void ED::SmoothRegions(Size ksize, double sigma, int margin)
+{
+	smoothImage.create(height, width, srcImage.type());
+	smoothImg = smoothImage.data;
+
+	Rect image(0, 0, width, height);
+	for (size_t k = 0; k < regionRects.size(); k++) {
+		Rect r = regionRects[k];
+		Rect s = Rect(r.x - margin, r.y - margin, r.width + 2 * margin, r.height + 2 * margin) & image;
+
+		// ROI blurring uses the pixels around the rectangle, so results match the full image blur
+		Mat dst = smoothImage(s);
+		GaussianBlur(srcImage(s), dst, ksize, sigma);
+	} //end-for
+}
+
+// Stretches a 16-bit or float source (and smoothed) image to 8 bits for the detectors that work on 8-bit pixels
+void ED::ConvertTo8Bit()
+{
+	if (srcImage.depth() == CV_8U) return;
+
+	double minVal, maxVal;
+	minMaxLoc(srcImage, &minVal, &maxVal);
+	double alpha = maxVal > minVal ? 255.0 / (maxVal - minVal) : 1.0;
+
+	srcImage.convertTo(srcImage, CV_8U, alpha, -minVal*alpha);
+	if (!smoothImage.empty()) smoothImage.convertTo(smoothImage, CV_8U, alpha, -minVal*alpha);
+
+	srcImg = srcImage.data;
+	smoothImg = smoothImage.data;
+}
+
+// Is pixel (r, c) inside the regions? (only meaningful if regionRects is not empty)
+bool ED::InRegion(int r, int c)
+{
+	if (!regions.mask.empty()) {
+		if (regions.mask.at<uchar>(r, c) == 0) return false;
+		if (regions.rois.empty()) return true; // the rectangles cover the mask
+	} //end-if
+
+	for (size_t k = 0; k < regionRects.size(); k++)
+		if (regionRects[k].contains(Point(c, r))) return true;
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------
+// Fused smoothing, gradient & anchor computation.
+// The image is streamed in bands of rows. Each band is smoothed into a small ring of rows
+// (the last two smoothed rows of a band are carried over to the next one), its gradient is
+// computed from the ring and anchors are marked while the gradient rows are still in cache.
+// The full-size smoothed image is never written.
+//
+void ED::ComputeGradientAndAnchorsByBands(EDWorkspace *ws)
+{
+	InitGradientBorders();
+
+	int band = bandHeight;
+	if (band <= 0) band = MAX(16, (256 * 1024) / (4 * width)); // keep a band of smooth+grad+dir+edge rows around 256KB
+	if (band > height - 2) band = height - 2;
+
+	// ring holds smoothed rows r0-1 ... r1 of the current band [r0, r1)
+	uchar *ring = ws->getSmoothRows((band + 2)*width);
+
+	int anchorRow = 2; // next row whose anchors are to be computed
+	for (int r0 = 1; r0 < height - 1; r0 += band) {
+		int r1 = MIN(r0 + band, height - 1);
+
+		int firstNewRow; // first smoothed row that is not in the ring yet
+		if (r0 == 1) firstNewRow = 0;
+		else {
+			memmove(ring, ring + band*width, 2 * width); // carry over rows r0-1 & r0 from the end of the ring
+			firstNewRow = r0 + 1;
+		} //end-else
+
+		Mat srcRows = srcImage.rowRange(firstNewRow, r1 + 1);
+		Mat smoothRows = Mat(r1 + 1 - firstNewRow, width, CV_8UC1, ring + (firstNewRow - (r0 - 1))*width);
+
+		// ROI blurring uses the pixels around the rows, so results match the full image blur
+		if (sigma == 1.0)
+			GaussianBlur(srcRows, smoothRows, Size(5, 5), sigma);
+		else
+			GaussianBlur(srcRows, smoothRows, Size(), sigma); // calculate kernel from sigma
+
+		ComputeGradientRows(op, sumFlag, ring + width, gradImg + r0*width, dirImg + r0*width, width, gradThresh, r1 - r0);
+
+		// Gradient is now available up to row r1-1, so anchors can be computed up to row r1-2
+		int anchorRowEnd = MIN(r1 - 1, height - 2);
+		if (anchorRowEnd > anchorRow) {
+			ComputeAnchorRows(anchorRow, anchorRowEnd, anchorPoints);
+			anchorRow = anchorRowEnd;
+		} //end-if
+	} //end-for
 
 	anchorNos = (int)anchorPoints.size(); // get the total number of anchor points
 }
 
-void ED::JoinAnchorPointsUsingSortedAnchors()
+//-----------------------------------------------------------------------------------------
+// Band-parallel gradient & anchor computation on threadPool.
+// Rows are split into bands that are processed as independent tasks in two phases:
+// first the gradient of every band (smoothing the band's rows too in the fused pipeline),
+// then the anchors of every band into a per-band list, since anchors need the gradient of
+// the neighbouring rows. The per-band lists are concatenated in band order, so anchorPoints
+// (and everything computed from it) is identical to the serial result.
+//
+void ED::ComputeGradientAndAnchorsParallel(EDWorkspace *ws, bool fused)
 {
-	int *chainNos = new int[(width + height) * 8];
+	InitGradientBorders();
+
+	int noWorkers = threadPool->get_workers_num();
+	int band = bandHeight;
+	if (band <= 0) band = MAX(8, (height - 2 + 4 * noWorkers - 1) / (4 * noWorkers)); // ~4 bands per worker for load balancing
+	if (band > height - 2) band = height - 2;
+	int noBands = (height - 2 + band - 1) / band;
+
+	// in the fused pipeline, each band smooths its rows r0-1 ... r1 into its own part of this buffer
+	uchar *bandRows = fused ? ws->getSmoothRows(noBands*(band + 2)*width) : NULL;
 
-	Point *pixels = new Point[width*height];
-	StackNode *stack = new StackNode[width*height];
-	Chain *chains = new Chain[width*height];
+	vector<std::future<void>> results;
+	results.reserve(noBands);
+
+	/*------------ PHASE 1: (SMOOTH &) COMPUTE GRADIENT -------------------*/
+	for (int b = 0; b < noBands; b++) {
+		results.push_back(threadPool->enqueue([this, b, band, bandRows] {
+			int r0 = 1 + b*band;
+			int r1 = MIN(r0 + band, height - 1);
+
+			if (bandRows) {
+				uchar *rows = bandRows + b*(band + 2)*width;
+				Mat smoothRows = Mat(r1 - r0 + 2, width, CV_8UC1, rows);
+
+				// ROI blurring uses the pixels around the rows, so results match the full image blur
+				if (sigma == 1.0)
+					GaussianBlur(srcImage.rowRange(r0 - 1, r1 + 1), smoothRows, Size(5, 5), sigma);
+				else
+					GaussianBlur(srcImage.rowRange(r0 - 1, r1 + 1), smoothRows, Size(), sigma); // calculate kernel from sigma
+
+				ComputeGradientRows(op, sumFlag, rows + width, gradImg + r0*width, dirImg + r0*width, width, gradThresh, r1 - r0);
+			}
+			else
+				ComputeGradientRect(r0, r1 - r0); // any depth
+		}));
+	} //end-for
+
+	WaitForTasks(results);
+	results.clear();
+
+	/*------------ PHASE 2: COMPUTE ANCHORS -------------------*/
+	vector<vector<Point>> bandAnchors(noBands);
+	for (int b = 0; b < noBands; b++) {
+		results.push_back(threadPool->enqueue([this, b, band, &bandAnchors] {
+			int r0 = MAX(1 + b*band, 2);
+			int r1 = MIN(1 + (b + 1)*band, height - 2);
+			if (r0 < r1) ComputeAnchorRows(r0, r1, bandAnchors[b]);
+		}));
+	} //end-for
+
+	WaitForTasks(results);
+
+	// Merge in band order
+	size_t noAnchors = 0;
+	for (int b = 0; b < noBands; b++) noAnchors += bandAnchors[b].size();
+	anchorPoints.reserve(noAnchors);
+	for (int b = 0; b < noBands; b++) anchorPoints.insert(anchorPoints.end(), bandAnchors[b].begin(), bandAnchors[b].end());
+
+	anchorNos = (int)anchorPoints.size(); // get the total number of anchor points
+}
+
+void ED::JoinAnchorPointsUsingSortedAnchors(EDWorkspace *ws)
+{
+	int *chainNos;
+
+	// Pixel, stack & chain buffers of a walk start small and grow with the longest walk,
+	// up to maxLinkMemory bytes in total (if set)
+	int initialSize = MAX(16, MIN(width*height, 4096));
+	if (maxLinkMemory > 0) initialSize = MAX(16, MIN(initialSize, (int)MIN(maxLinkMemory / (sizeof(Point) + sizeof(StackNode) + sizeof(Chain)), (size_t)4096)));
+	int pixelsCap = initialSize, stackCap = initialSize, chainsCap = initialSize;
+	Point *pixels = ws->getPixels(pixelsCap);
+	StackNode *stack = ws->getStack(stackCap);
+	Chain *chains = ws->getChains(chainsCap);
+
+	int noChains = 0;
+	int len = 0;
+	int top = -1;
+	noTruncatedWalks = 0;
+
+	// Segments go to the sink as soon as they are closed, unless they still have to be merged with kept ones
+	EDSegmentSink *sink = keptSegments ? NULL : segmentSink;
+
+	// Makes room for at least the given number of pixels, stack nodes & chains of the current walk, keeping
+	// their contents. Returns false if that would exceed maxLinkMemory.
+	auto fits = [&](int noPixels, int noStackNodes, int noChainsNeeded) -> bool {
+		int newPixelsCap = noPixels > pixelsCap ? MAX(noPixels, 2 * pixelsCap) : pixelsCap;
+		int newStackCap = noStackNodes > stackCap ? MAX(noStackNodes, 2 * stackCap) : stackCap;
+		int newChainsCap = noChainsNeeded > chainsCap ? MAX(noChainsNeeded, 2 * chainsCap) : chainsCap;
+
+		if (maxLinkMemory > 0) {
+			size_t bytes = newPixelsCap*sizeof(Point) + newStackCap*sizeof(StackNode) + newChainsCap*sizeof(Chain);
+			if (bytes > maxLinkMemory) {
+				// no room to double, try just what is needed
+				newPixelsCap = MAX(noPixels, pixelsCap);
+				newStackCap = MAX(noStackNodes, stackCap);
+				newChainsCap = MAX(noChainsNeeded, chainsCap);
+
+				bytes = newPixelsCap*sizeof(Point) + newStackCap*sizeof(StackNode) + newChainsCap*sizeof(Chain);
+				if (bytes > maxLinkMemory) return false;
+			} //end-if
+		} //end-if
+
+		if (newPixelsCap > pixelsCap) {
+			Point *oldPixels = pixels;
+			pixels = ws->getPixels(newPixelsCap, len);
+
+			// chains point into the pixel buffer
+			for (int k = 1; k <= noChains && k < chainsCap; k++) chains[k].pixels = pixels + (chains[k].pixels - oldPixels);
+			pixelsCap = newPixelsCap;
+		} //end-if
+
+		if (newStackCap > stackCap) { stack = ws->getStack(newStackCap, top + 1); stackCap = newStackCap; }
+		if (newChainsCap > chainsCap) { chains = ws->getChains(newChainsCap, noChains + 1); chainsCap = newChainsCap; }
+
+		return true;
+	};
 
 	// sort the anchor points by their gradient value in decreasing order
-	int *A = sortAnchorsByGradValue1();
+	int *A = sortAnchorsByGradValue1(ws);
 
 	// Now join the anchors starting with the anchor having the greatest gradient value
 	int totalPixels = 0;
@@ -429,10 +1053,11 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 		chains[0].pixels = NULL;
 
 
-		int noChains = 1;
-		int len = 0;
+		noChains = 1;
+		len = 0;
 		int duplicatePixelCount = 0;
-		int top = -1;  // top of the stack 
+		top = -1;  // top of the stack 
+		bool truncated = false; // walk cut short by maxLinkMemory
 
 		if (dirImg[i*width + j] == EDGE_VERTICAL) {
 			stack[++top].r = i;
@@ -460,7 +1085,10 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 
 		  // While the stack is not empty
 	StartOfWhile:
-		while (top >= 0) {
+		while (top >= 0 && !truncated) {
+			// room for this chain & the two stack nodes it may push
+			if ((noChains >= chainsCap || top + 1 >= stackCap) && !fits(0, top + 2, noChains + 1)) { truncated = true; break; }
+
 			int r = stack[top].r;
 			int c = stack[top].c;
 			int dir = stack[top].dir;
@@ -477,6 +1105,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 			int chainLen = 0;
 
 			chains[noChains].pixels = &pixels[len];
+			if (len >= pixelsCap && !fits(len + 1, 0, 0)) { truncated = true; break; }
 
 			pixels[len].y = r;
 			pixels[len].x = c;
@@ -515,7 +1144,8 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 						c--;
 					} //end-else
 
-					if (edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
+					if (len >= pixelsCap && !fits(len + 1, 0, 0)) truncated = true;
+					if (truncated || edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
 						if (chainLen > 0) {
 							chains[noChains].len = chainLen;
 							chains[parent].children[0] = noChains;
@@ -581,7 +1211,8 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 						c++;
 					} //end-else
 
-					if (edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
+					if (len >= pixelsCap && !fits(len + 1, 0, 0)) truncated = true;
+					if (truncated || edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
 						if (chainLen > 0) {
 							chains[noChains].len = chainLen;
 							chains[parent].children[1] = noChains;
@@ -646,7 +1277,8 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 						r--;
 					} //end-else
 
-					if (edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
+					if (len >= pixelsCap && !fits(len + 1, 0, 0)) truncated = true;
+					if (truncated || edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
 						if (chainLen > 0) {
 							chains[noChains].len = chainLen;
 							chains[parent].children[0] = noChains;
@@ -712,7 +1344,8 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 						r++;
 					} //end-else
 
-					if (edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
+					if (len >= pixelsCap && !fits(len + 1, 0, 0)) truncated = true;
+					if (truncated || edgeImg[r*width + c] == EDGE_PIXEL || gradImg[r*width + c] < gradThresh) {
 						if (chainLen > 0) {
 							chains[noChains].len = chainLen;
 							chains[parent].children[1] = noChains;
@@ -749,7 +1382,11 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 		} //end-while
 
 
-		if (len - duplicatePixelCount < minPathLen) {
+		if (truncated) noTruncatedWalks++;
+
+		// In tiled linking, a short walk that reached a tile border may continue in the next tile, so keep it for stitching
+		bool shortWalk = len - duplicatePixelCount < minPathLen;
+		if (shortWalk && !(tileSides && TouchesTileBorder(pixels, len))) {
 			for (int k = 0; k<len; k++) {
 
 				edgeImg[pixels[k].y*width + pixels[k].x] = 0;
@@ -759,6 +1396,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 
 		}
 		else {
+			chainNos = ws->getChainNos(noChains);
 
 			int noSegmentPixels = 0;
 
@@ -785,7 +1423,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 
 						if (dr <= 1 && dc <= 1) {
 							// neighbors. Erase last pixel
-							segmentPoints[segmentNos].pop_back();
+							segmentPoints.removeLastPoint();
 							noSegmentPixels--;
 							index--;
 						}
@@ -804,7 +1442,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 #endif
 
 					for (int l = chains[chainNo].len - 1; l >= 0; l--) {
-						segmentPoints[segmentNos].push_back(chains[chainNo].pixels[l]);
+						segmentPoints.addPoint(chains[chainNo].pixels[l]);
 						noSegmentPixels++;
 					} //end-for
 
@@ -838,7 +1476,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 
 						if (dr <= 1 && dc <= 1) {
 							// neighbors. Erase last pixel
-							segmentPoints[segmentNos].pop_back();
+							segmentPoints.removeLastPoint();
 							noSegmentPixels--;
 							index--;
 						}
@@ -860,7 +1498,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 
 					  /* Start a new chain & copy pixels from the new chain */
 					for (int l = startIndex; l<chains[chainNo].len; l++) {
-						segmentPoints[segmentNos].push_back(chains[chainNo].pixels[l]);
+						segmentPoints.addPoint(chains[chainNo].pixels[l]);
 						noSegmentPixels++;
 					} //end-for
 
@@ -869,22 +1507,25 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 			} //end-if
 
 
-			  // See if the first pixel can be cleaned up
-			int fr = segmentPoints[segmentNos][1].y;
-			int fc = segmentPoints[segmentNos][1].x;
+			  // See if the first pixel can be cleaned up (a short walk kept in tiled linking may have a single pixel)
+			if (noSegmentPixels > 1) {
+				int fr = segmentPoints[segmentNos][1].y;
+				int fc = segmentPoints[segmentNos][1].x;
 
 
-			int dr = abs(fr - segmentPoints[segmentNos][noSegmentPixels - 1].y);
-			int dc = abs(fc - segmentPoints[segmentNos][noSegmentPixels - 1].x);
+				int dr = abs(fr - segmentPoints[segmentNos][noSegmentPixels - 1].y);
+				int dc = abs(fc - segmentPoints[segmentNos][noSegmentPixels - 1].x);
 
 
-			if (dr <= 1 && dc <= 1) {
-				segmentPoints[segmentNos].erase(segmentPoints[segmentNos].begin());
-				noSegmentPixels--;
+				if (dr <= 1 && dc <= 1) {
+					segmentPoints.removeFirstPoint();
+					noSegmentPixels--;
+				} //end-if
 			} //end-if
 
 			segmentNos++;
-			segmentPoints.push_back(vector<Point>()); // create empty vector of points for segments
+			segmentPoints.closeSegment(); // pixels added from now on form the next segment
+			if (sink) sink->segment(segmentNos - 1, segmentPoints[segmentNos - 1]);
 
 													  // Copy the rest of the long chains here
 			for (int k = 2; k<noChains; k++) {
@@ -914,7 +1555,7 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 
 							if (dr <= 1 && dc <= 1) {
 								// neighbors. Erase last pixel
-								segmentPoints[segmentNos].pop_back();
+								segmentPoints.removeLastPoint();
 								noSegmentPixels--;
 								index--;
 							}
@@ -935,31 +1576,282 @@ void ED::JoinAnchorPointsUsingSortedAnchors()
 #endif
 						  /* Start a new chain & copy pixels from the new chain */
 						for (int l = startIndex; l<chains[chainNo].len; l++) {
-							segmentPoints[segmentNos].push_back(chains[chainNo].pixels[l]);
+							segmentPoints.addPoint(chains[chainNo].pixels[l]);
 							noSegmentPixels++;
 						} //end-for
 
 						chains[chainNo].len = 0;  // Mark as copied
 					} //end-for
-					segmentPoints.push_back(vector<Point>()); // create empty vector of points for segments
+					segmentPoints.closeSegment(); // pixels added from now on form the next segment
 					segmentNos++;
+					if (sink) sink->segment(segmentNos - 1, segmentPoints[segmentNos - 1]);
 				} //end-if          
 			} //end-for
 
+			if (tileSides) tileShortSegments.resize(segmentNos, shortWalk);
 		} //end-else
 
 	} //end-for-outer
 
-	// pop back last segment from vector
-	// because of one preallocation in the beginning, it will always empty
-	segmentPoints.pop_back();
+	// drop the pixels of the open segment (nothing is left there after the last closed segment)
+	segmentPoints.discardOpen();
+}
 
-	// Clean up
-	delete[] A;
-	delete[] chains;
-	delete[] stack;
-	delete[] chainNos;
-	delete[] pixels;
+//-----------------------------------------------------------------------------------------
+// Tiled edge linking.
+// The image is split into tileSize x tileSize tiles that are linked independently (in parallel if a
+// thread pool is set). Each tile is copied into a buffer with a one pixel halo whose gradient is below
+// the threshold, so JoinAnchorPointsUsingSortedAnchors walks stop at the tile border exactly as they
+// stop at the image border. Anchors of a tile are linked in decreasing gradient order as usual.
+// Segments cut at a tile border are then stitched to the segment whose end touches them across the border.
+//
+// Differences from serial linking (counted in tileStats):
+//  - A walk cannot continue into the next tile, so the next tile may start it from another anchor and
+//    follow a slightly different path near the border; such ends may find no partner to stitch to.
+//  - Anchors next to a walk across a tile border are not cleaned up and may start extra short walks.
+//  - A short walk that reached a border is kept until stitching and dropped only if still shorter than
+//    minPathLen, so its pixels are not available to other walks of its tile in the meantime.
+//
+void ED::JoinAnchorPointsByTiles(EDWorkspace *ws)
+{
+	int T = tileSize > 0 ? MAX(tileSize, 16) : 512;
+	int tileRows = (height + T - 1) / T;
+	int tileCols = (width + T - 1) / T;
+	int noTiles = tileRows*tileCols;
+
+	memset(&tileStats, 0, sizeof(tileStats));
+	tileStats.noTiles = noTiles;
+
+	vector<EDSegments> tileSegments(noTiles);
+	vector<vector<char>> tileShortFlags(noTiles);
+	vector<int> tileTruncatedWalks(noTiles, 0);
+
+	int noTasks = threadPool ? MIN(threadPool->get_workers_num(), noTiles) : 1;
+	if (noTasks < 1) noTasks = 1;
+	EDWorkspace *tileWs = ws->getTileWorkspaces(noTasks);
+
+	// Task t links tiles t, t + noTasks, ... with its own workspace. Tiles only write their own part of edgeImg.
+	auto linkTiles = [this, T, tileCols, noTiles, noTasks, tileWs, &tileSegments, &tileShortFlags, &tileTruncatedWalks](int task) {
+		for (int t = task; t < noTiles; t += noTasks) {
+			int r0 = (t / tileCols)*T;
+			int c0 = (t % tileCols)*T;
+			tileTruncatedWalks[t] = LinkTile(r0, MIN(r0 + T, height), c0, MIN(c0 + T, width), &tileWs[task], tileSegments[t], tileShortFlags[t]);
+		} //end-for
+	};
+
+	if (noTasks > 1) {
+		vector<std::future<void>> results;
+		for (int task = 0; task < noTasks; task++) results.push_back(threadPool->enqueue(linkTiles, task));
+		WaitForTasks(results);
+	}
+	else linkTiles(0);
+
+	// Gather the segments in tile order
+	int noPoints = 0, noSegs = 0;
+	noTruncatedWalks = 0;
+	for (int t = 0; t < noTiles; t++) { noPoints += tileSegments[t].totalPoints(); noSegs += tileSegments[t].size(); noTruncatedWalks += tileTruncatedWalks[t]; }
+
+	EDSegments segments;
+	segments.reserve(noPoints, noSegs);
+	vector<char> shortFlags;
+	vector<int> segmentTiles;
+	for (int t = 0; t < noTiles; t++) {
+		for (int k = 0; k < tileSegments[t].size(); k++) {
+			segments.append(tileSegments[t][k]);
+			shortFlags.push_back(tileShortFlags[t][k]);
+			segmentTiles.push_back(t);
+		} //end-for
+	} //end-for
+
+	StitchTileSegments(segments, shortFlags, segmentTiles, tileCols, T);
+}
+
+// Links the anchors of tile [r0, r1) x [c0, c1) and appends its segments (in image coordinates) to segments.
+// Returns the number of walks cut short by maxLinkMemory.
+int ED::LinkTile(int r0, int r1, int c0, int c1, EDWorkspace *ws, EDSegments &segments, vector<char> &shortFlags)
+{
+	int tw = c1 - c0 + 2;
+	int th = r1 - r0 + 2;
+
+	short *tGrad = ws->getGradImg(tw*th);
+	uchar *tDir = ws->getDirImg(tw*th);
+	uchar *tEdge = ws->getEdgeImg(tw*th);
+
+	// Halo: below the threshold & no edge pixels
+	short below = (short)(MIN(gradThresh, SHRT_MAX) - 1);
+	for (int j = 0; j < tw; j++) {
+		tGrad[j] = tGrad[(th - 1)*tw + j] = below;
+		tDir[j] = tDir[(th - 1)*tw + j] = 0;
+		tEdge[j] = tEdge[(th - 1)*tw + j] = 0;
+	} //end-for
+
+	int noAnchors = 0;
+	for (int i = r0; i < r1; i++) {
+		int ti = (i - r0 + 1)*tw;
+		tGrad[ti] = tGrad[ti + tw - 1] = below;
+		tDir[ti] = tDir[ti + tw - 1] = 0;
+		tEdge[ti] = tEdge[ti + tw - 1] = 0;
+
+		memcpy(tGrad + ti + 1, gradImg + i*width + c0, (c1 - c0)*sizeof(short));
+		memcpy(tDir + ti + 1, dirImg + i*width + c0, c1 - c0);
+		memcpy(tEdge + ti + 1, edgeImg + i*width + c0, c1 - c0);
+
+		for (int j = c0; j < c1; j++) if (edgeImg[i*width + j] == ANCHOR_PIXEL) noAnchors++;
+	} //end-for
+
+	// Link the tile as a small image of its own
+	ED tile;
+	tile.width = tw;
+	tile.height = th;
+	tile.gradImg = tGrad;
+	tile.dirImg = tDir;
+	tile.edgeImg = tEdge;
+	tile.gradThresh = gradThresh;
+	tile.minPathLen = minPathLen;
+	tile.maxLinkMemory = maxLinkMemory;
+	tile.anchorNos = noAnchors;
+	tile.segmentNos = 0;
+	tile.tileSides = (r0 > 0 ? TILE_TOP : 0) | (r1 < height ? TILE_BOTTOM : 0) | (c0 > 0 ? TILE_LEFT : 0) | (c1 < width ? TILE_RIGHT : 0);
+
+	tile.JoinAnchorPointsUsingSortedAnchors(ws);
+
+	for (int i = r0; i < r1; i++) memcpy(edgeImg + i*width + c0, tEdge + (i - r0 + 1)*tw + 1, c1 - c0);
+
+	tile.tileShortSegments.resize(tile.segmentNos, 0);
+	Point offset(c0 - 1, r0 - 1);
+	segments.reserve(tile.segmentPoints.totalPoints(), tile.segmentNos);
+	for (int k = 0; k < tile.segmentNos; k++) {
+		EDSegmentView segment = tile.segmentPoints[k];
+		for (int l = 0; l < segment.size(); l++) segments.addPoint(segment[l] + offset);
+		segments.closeSegment();
+
+		shortFlags.push_back(tile.tileShortSegments[k]);
+	} //end-for
+
+	return tile.noTruncatedWalks;
+}
+
+// Joins segment ends that touch each other across a tile border, drops stitched-up segments that are
+// still too short and stores the result in segmentPoints
+void ED::StitchTileSegments(const EDSegments &segments, vector<char> &shortFlags, vector<int> &segmentTiles, int tileCols, int T)
+{
+	int noSegs = segments.size();
+
+	// Segment end e (0: first, 1: last pixel) of segment s has id 2*s + e
+	vector<int> link(2 * noSegs, -1);
+	vector<int> borderEnds;
+	std::unordered_map<int, int> endAt; // pixel offset -> end id, for ends on a tile border
+
+	for (int s = 0; s < noSegs; s++) {
+		int r0 = (segmentTiles[s] / tileCols)*T, r1 = MIN(r0 + T, height);
+		int c0 = (segmentTiles[s] % tileCols)*T, c1 = MIN(c0 + T, width);
+
+		for (int e = 0; e < 2; e++) {
+			if (segments[s].size() < e + 1) break;
+			Point p = e == 0 ? segments[s].front() : segments[s].back();
+
+			if ((p.y == r0 && r0 > 0) || (p.y == r1 - 1 && r1 < height) || (p.x == c0 && c0 > 0) || (p.x == c1 - 1 && c1 < width)) {
+				borderEnds.push_back(2 * s + e);
+				endAt.emplace(p.y*width + p.x, 2 * s + e);
+			} //end-if
+		} //end-for
+	} //end-for
+
+	tileStats.noBorderEnds = (int)borderEnds.size();
+
+	// Match each cut end with an unmatched end of another tile's segment among its neighbors (4-neighbors first)
+	static const int dr[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+	static const int dc[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+
+	for (int k = 0; k < (int)borderEnds.size(); k++) {
+		int id = borderEnds[k];
+		if (link[id] >= 0) continue;
+
+		int s = id / 2;
+		Point p = id % 2 == 0 ? segments[s].front() : segments[s].back();
+
+		for (int n = 0; n < 8; n++) {
+			int r = p.y + dr[n];
+			int c = p.x + dc[n];
+			if (r < 0 || r >= height || c < 0 || c >= width) continue;
+
+			std::unordered_map<int, int>::iterator it = endAt.find(r*width + c);
+			if (it == endAt.end()) continue;
+
+			int other = it->second;
+			if (other / 2 == s || segmentTiles[other / 2] == segmentTiles[s] || link[other] >= 0) continue;
+
+			link[id] = other;
+			link[other] = id;
+			tileStats.noStitches++;
+			break;
+		} //end-for
+	} //end-for
+
+	tileStats.noUnmatchedEnds = tileStats.noBorderEnds - 2 * tileStats.noStitches;
+
+	// Concatenate linked segments in the order of their first member
+	segmentPoints.clear();
+	segmentPoints.reserve(segments.totalPoints(), noSegs);
+	vector<char> copied(noSegs, 0);
+
+	for (int s = 0; s < noSegs; s++) {
+		if (copied[s]) continue;
+
+		// Find the free end of the group by walking backwards from the first end of s (or stay at s on a loop)
+		int head = s, entry = 0;
+		while (link[2 * head + entry] >= 0) {
+			int other = link[2 * head + entry];
+			head = other / 2;
+			entry = 1 - other % 2;
+			if (head == s) { entry = 0; break; }
+		} //end-while
+
+		// Copy the group into the open segment of segmentPoints
+		bool anyShort = false;
+		int cur = head;
+		int e = entry;
+		while (true) {
+			copied[cur] = 1;
+			if (shortFlags[cur]) anyShort = true;
+
+			EDSegmentView segment = segments[cur];
+			if (e == 0) for (int l = 0; l < segment.size(); l++) segmentPoints.addPoint(segment[l]);
+			else        for (int l = segment.size() - 1; l >= 0; l--) segmentPoints.addPoint(segment[l]);
+
+			int other = link[2 * cur + 1 - e];
+			if (other < 0) break;
+
+			cur = other / 2;
+			e = other % 2;
+			if (copied[cur]) break; // closed loop
+		} //end-while
+
+		EDSegmentView joined = segmentPoints[segmentPoints.size()];
+		if (anyShort && joined.size() < minPathLen) {
+			for (int k = 0; k < joined.size(); k++) edgeImg[joined[k].y*width + joined[k].x] = 0;
+			segmentPoints.discardOpen();
+			tileStats.noDroppedSegments++;
+			continue;
+		} //end-if
+
+		segmentPoints.closeSegment();
+	} //end-for
+
+	segmentNos = segmentPoints.size();
+}
+
+// True if one of the pixels (tile coordinates) lies on an internal border of the tile being linked
+bool ED::TouchesTileBorder(Point *pixels, int len)
+{
+	for (int k = 0; k < len; k++) {
+		if ((tileSides & TILE_TOP) && pixels[k].y == 1) return true;
+		if ((tileSides & TILE_BOTTOM) && pixels[k].y == height - 2) return true;
+		if ((tileSides & TILE_LEFT) && pixels[k].x == 1) return true;
+		if ((tileSides & TILE_RIGHT) && pixels[k].x == width - 2) return true;
+	} //end-for
+
+	return false;
 }
 
 void ED::sortAnchorsByGradValue()
@@ -997,41 +1889,55 @@ void ED::sortAnchorsByGradValue()
 	*/
 }
 
-int * ED::sortAnchorsByGradValue1()
+int * ED::sortAnchorsByGradValue1(EDWorkspace *ws)
 {
-	int SIZE = 128 * 256;
-	int *C = new int[SIZE];
+	int SIZE = 128 * 256; // one bucket per value of the 16-bit gradient map (scaled for 16-bit & float input)
+	int *C = ws->getGradCounts(SIZE);
 	memset(C, 0, sizeof(int)*SIZE);
 
+	// Restricted to regions, the anchors are taken from the anchor list rather than by scanning the whole image
+	bool useList = !regionRects.empty();
+
 	// Count the number of grad values
-	for (int i = 1; i<height - 1; i++) {
-		for (int j = 1; j<width - 1; j++) {
-			if (edgeImg[i*width + j] != ANCHOR_PIXEL) continue;
+	if (useList) {
+		for (size_t k = 0; k < anchorPoints.size(); k++) C[gradImg[anchorPoints[k].y*width + anchorPoints[k].x]]++;
+	}
+	else {
+		for (int i = 1; i<height - 1; i++) {
+			for (int j = 1; j<width - 1; j++) {
+				if (edgeImg[i*width + j] != ANCHOR_PIXEL) continue;
 
-			int grad = gradImg[i*width + j];
-			C[grad]++;
-		} //end-for
-	} //end-for 
+				int grad = gradImg[i*width + j];
+				C[grad]++;
+			} //end-for
+		} //end-for 
+	} //end-else
 
 	// Compute indices
 	for (int i = 1; i<SIZE; i++) C[i] += C[i - 1];
 
 	int noAnchors = C[SIZE - 1];
-	int *A = new int[noAnchors];
+	int *A = ws->getSortedAnchors(noAnchors);
 	memset(A, 0, sizeof(int)*noAnchors);
 
 
-	for (int i = 1; i<height - 1; i++) {
-		for (int j = 1; j<width - 1; j++) {
-			if (edgeImg[i*width + j] != ANCHOR_PIXEL) continue;
-
-			int grad = gradImg[i*width + j];
-			int index = --C[grad];
-			A[index] = i*width + j;    // anchor's offset 
+	if (useList) {
+		for (size_t k = 0; k < anchorPoints.size(); k++) {
+			int offset = anchorPoints[k].y*width + anchorPoints[k].x;
+			A[--C[gradImg[offset]]] = offset;    // anchor's offset 
 		} //end-for
-	} //end-for  
+	}
+	else {
+		for (int i = 1; i<height - 1; i++) {
+			for (int j = 1; j<width - 1; j++) {
+				if (edgeImg[i*width + j] != ANCHOR_PIXEL) continue;
 
-	delete[] C;
+				int grad = gradImg[i*width + j];
+				int index = --C[grad];
+				A[index] = i*width + j;    // anchor's offset 
+			} //end-for
+		} //end-for  
+	} //end-else
 
 	/*
 	ofstream myFile;
@@ -1084,3 +1990,96 @@ int ED::RetrieveChainNos(Chain * chains, int root, int chainNos[])
 
 	return count;
 }
+
+
+EDWorkspace::EDWorkspace()
+{
+	edgeImg = NULL; edgeImgSize = 0;
+	smoothImg = NULL; smoothImgSize = 0;
+	gradImg = NULL; gradImgSize = 0;
+	dirImg = NULL; dirImgSize = 0;
+	smoothRows = NULL; smoothRowsSize = 0;
+	tileWorkspaces = NULL; tileWorkspacesSize = 0;
+
+	pixels = NULL; pixelsSize = 0;
+	stack = NULL; stackSize = 0;
+	chains = NULL; chainsSize = 0;
+	chainNos = NULL; chainNosSize = 0;
+	gradCounts = NULL; gradCountsSize = 0;
+	sortedAnchors = NULL; sortedAnchorsSize = 0;
+
+	pointX = NULL; pointXSize = 0;
+	pointY = NULL; pointYSize = 0;
+	rectX = NULL; rectXSize = 0;
+	rectY = NULL; rectYSize = 0;
+}
+
+EDWorkspace::~EDWorkspace()
+{
+	delete[] edgeImg;
+	delete[] smoothImg;
+	delete[] gradImg;
+	delete[] dirImg;
+	delete[] smoothRows;
+	delete[] tileWorkspaces;
+
+	delete[] pixels;
+	delete[] stack;
+	delete[] chains;
+	delete[] chainNos;
+	delete[] gradCounts;
+	delete[] sortedAnchors;
+
+	delete[] pointX;
+	delete[] pointY;
+	delete[] rectX;
+	delete[] rectY;
+}
+
+// Grows the buffer to hold at least size elements. Only the first keep elements of the old contents are preserved.
+template <class T>
+T * EDWorkspace::Reserve(T *& buffer, int & capacity, int size, int keep)
+{
+	if (size > capacity || buffer == NULL) {
+		T *old = buffer;
+		int newCapacity = size > 0 ? size : 1; // never hand out a NULL buffer, even for empty requests
+		buffer = new T[newCapacity];
+		if (old != NULL && keep > 0) std::copy(old, old + MIN(keep, capacity), buffer);
+
+		delete[] old;
+		capacity = newCapacity;
+	} //end-if
+
+	return buffer;
+}
+
+uchar * EDWorkspace::getEdgeImg(int size) { return Reserve(edgeImg, edgeImgSize, size); }
+uchar * EDWorkspace::getSmoothImg(int size) { return Reserve(smoothImg, smoothImgSize, size); }
+short * EDWorkspace::getGradImg(int size) { return Reserve(gradImg, gradImgSize, size); }
+uchar * EDWorkspace::getDirImg(int size) { return Reserve(dirImg, dirImgSize, size); }
+uchar * EDWorkspace::getSmoothRows(int size) { return Reserve(smoothRows, smoothRowsSize, size); }
+EDWorkspace * EDWorkspace::getTileWorkspaces(int count)
+{
+	// Workspaces are not copyable, so nothing is kept when they grow
+	if (count > tileWorkspacesSize || tileWorkspaces == NULL) {
+		delete[] tileWorkspaces;
+		tileWorkspacesSize = count > 0 ? count : 1;
+		tileWorkspaces = new EDWorkspace[tileWorkspacesSize];
+	} //end-if
+
+	return tileWorkspaces;
+}
+
+EDArena * EDWorkspace::getArena() { return &arena; }
+
+Point * EDWorkspace::getPixels(int size, int keep) { return Reserve(pixels, pixelsSize, size, keep); }
+StackNode * EDWorkspace::getStack(int size, int keep) { return Reserve(stack, stackSize, size, keep); }
+Chain * EDWorkspace::getChains(int size, int keep) { return Reserve(chains, chainsSize, size, keep); }
+int * EDWorkspace::getChainNos(int size) { return Reserve(chainNos, chainNosSize, size); }
+int * EDWorkspace::getGradCounts(int size) { return Reserve(gradCounts, gradCountsSize, size); }
+int * EDWorkspace::getSortedAnchors(int size) { return Reserve(sortedAnchors, sortedAnchorsSize, size); }
+
+double * EDWorkspace::getPointX(int size) { return Reserve(pointX, pointXSize, size); }
+double * EDWorkspace::getPointY(int size) { return Reserve(pointY, pointYSize, size); }
+int * EDWorkspace::getRectX(int size) { return Reserve(rectX, rectXSize, size); }
+int * EDWorkspace::getRectY(int size) { return Reserve(rectY, rectYSize, size); }
@@ -28,7 +28,30 @@
 #define UP    3
 #define DOWN  4
 
-enum GradientOperator { PREWITT_OPERATOR = 101, SOBEL_OPERATOR = 102, SCHARR_OPERATOR = 103, LSD_OPERATOR = 104 };
+// Internal tile borders in tiled linking
+#define TILE_TOP    1
+#define TILE_BOTTOM 2
+#define TILE_LEFT   4
+#define TILE_RIGHT  8
+
+#include "EDGradient.h" // GradientOperator & gradient kernels
+#include "EDSegments.h"
+#include "EDChainCodes.h"
+#include "EDSegmentSink.h"
+#include "EDArena.h"
+#include "../ThreadPool/ThreadPool.h"
+
+// Waits for every task, then rethrows the first exception that any of them threw. Tasks usually refer to the
+// caller's locals, so none may still be running when an exception unwinds the caller's stack.
+inline void WaitForTasks(std::vector<std::future<void>> &tasks)
+{
+	std::exception_ptr error;
+	for (size_t t = 0; t < tasks.size(); t++) {
+		try { tasks[t].get(); }
+		catch (...) { if (!error) error = std::current_exception(); }
+	} //end-for
+	if (error) std::rethrow_exception(error);
+}
 
 struct StackNode {
 	int r, c;   // starting pixel
@@ -46,11 +69,115 @@ struct Chain {
 	cv::Point *pixels;         // Pointer to the beginning of the pixels array
 };
 
+// Report of the tiled edge linking mode (see ED::JoinAnchorPointsByTiles).
+// Tiled linking follows the serial result except where a walk meets a tile border;
+// these counts tell how often that happened for the last detection.
+struct EDTileLinkStats {
+	int noTiles;
+	int noBorderEnds;      // segment ends cut at a tile border
+	int noStitches;        // pairs of cut ends joined back across a tile border
+	int noUnmatchedEnds;   // cut ends without a partner across the border (linking differs from serial here)
+	int noDroppedSegments; // segments kept only because they reached a border, still too short after stitching
+};
+
+// Parts of the image that detection is restricted to: a list of rectangles and/or a binary mask
+// (non-zero: detect). If both are given, detection is restricted to the masked pixels inside the rectangles.
+// Everything else is neither smoothed, differentiated, scanned for anchors nor linked through, and
+// all results stay in full-image coordinates.
+struct EDRegions {
+	std::vector<cv::Rect> rois;
+	cv::Mat mask; // CV_8UC1, image sized
+
+	EDRegions() {}
+	EDRegions(const cv::Rect &roi) : rois(1, roi) {}
+	EDRegions(const std::vector<cv::Rect> &_rois) : rois(_rois) {}
+	EDRegions(const cv::Mat &_mask) : mask(_mask) {}
+
+	bool empty() const { return rois.empty() && mask.empty(); }
+};
+
+// One parameter set of a parameter sweep (see EDDetector::sweep)
+struct EDSweepParams {
+	double gradThresh; // in gradient units of the input, as for ED
+	double anchorThresh;
+	int minPathLen;
+	int scanInterval;
+
+	EDSweepParams(double _gradThresh = 20, double _anchorThresh = 0, int _minPathLen = 10, int _scanInterval = 1)
+		: gradThresh(_gradThresh), anchorThresh(_anchorThresh), minPathLen(_minPathLen), scanInterval(_scanInterval) {}
+};
+
+// Scratch buffers shared by ED, EDLines and EDCircles.
+// Buffers only grow, so a workspace that is reused across frames stops allocating
+// once it has seen the largest frame. A workspace must not be used by two detectors at the same time.
+struct EDWorkspace {
+	EDWorkspace();
+	~EDWorkspace();
+
+	uchar *getEdgeImg(int size);
+	uchar *getSmoothImg(int size);
+	short *getGradImg(int size);
+	uchar *getDirImg(int size);
+	uchar *getSmoothRows(int size);
+
+	cv::Point *getPixels(int size, int keep = 0); // keep: # of elements to preserve if the buffer grows
+	StackNode *getStack(int size, int keep = 0);
+	Chain *getChains(int size, int keep = 0);
+	int *getChainNos(int size);
+	int *getGradCounts(int size);
+	int *getSortedAnchors(int size);
+
+	double *getPointX(int size);
+	double *getPointY(int size);
+	int *getRectX(int size);
+	int *getRectY(int size);
+
+	EDWorkspace *getTileWorkspaces(int count); // one per concurrent tile linking task
+	EDArena *getArena(); // per-detection scratch of EDCircles, reset by each detection that uses it
+
+private:
+	EDWorkspace(const EDWorkspace &) = delete;
+	EDWorkspace &operator=(const EDWorkspace &) = delete;
+
+	template <class T> static T *Reserve(T *&buffer, int &capacity, int size, int keep = 0);
+
+	uchar *edgeImg; int edgeImgSize;
+	uchar *smoothImg; int smoothImgSize;
+	short *gradImg; int gradImgSize;
+	uchar *dirImg; int dirImgSize;
+	uchar *smoothRows; int smoothRowsSize;
+
+	cv::Point *pixels; int pixelsSize;
+	StackNode *stack; int stackSize;
+	Chain *chains; int chainsSize;
+	int *chainNos; int chainNosSize;
+	int *gradCounts; int gradCountsSize;
+	int *sortedAnchors; int sortedAnchorsSize;
+
+	double *pointX; int pointXSize;
+	double *pointY; int pointYSize;
+	int *rectX; int rectXSize;
+	int *rectY; int rectYSize;
+
+	EDWorkspace *tileWorkspaces; int tileWorkspacesSize;
+	EDArena arena;
+};
+
+// ED works on 8-bit, 16-bit (e.g. 12/16-bit sensor data) and float single channel images.
+// Thresholds are in gradient units of the input, e.g. gradThresh 20 on a 16-bit image is 20 of 65535 levels, and
+// 0.08 on a float image in [0, 1] is about the default 20 on an 8-bit image.
+// Gradients go into a 16-bit map (see getGradScale). They are kept exactly if the pixel range (max - min) of a 16-bit
+// image is at most 4095 with Prewitt & Sobel, 1023 with Scharr or 8191 with LSD, e.g. 12-bit sensor data with Prewitt
+// or Sobel. A wider range is scaled down by a power of two, which loses gradients below that factor (weak edges).
 class ED {
 							
 public:
-	ED(cv::Mat _srcImage, GradientOperator _op = PREWITT_OPERATOR, int _gradThresh = 20, int _anchorThresh = 0, int _scanInterval = 1, int _minPathLen = 10, double _sigma = 1.0, bool _sumFlag = true);
-	ED(const ED &cpyObj); 
+	ED(cv::Mat _srcImage, GradientOperator _op = PREWITT_OPERATOR, double _gradThresh = 20, double _anchorThresh = 0, int _scanInterval = 1, int _minPathLen = 10, double _sigma = 1.0, bool _sumFlag = true, EDWorkspace *_workspace = NULL);
+	ED(cv::Mat _srcImage, const EDRegions &_regions, GradientOperator _op = PREWITT_OPERATOR, double _gradThresh = 20, double _anchorThresh = 0, int _scanInterval = 1, int _minPathLen = 10, double _sigma = 1.0, bool _sumFlag = true, EDWorkspace *_workspace = NULL);
+	ED(const ED &cpyObj); // shares the images of cpyObj (see ShareResults)
+	ED(ED &&cpyObj);
+	ED &operator=(const ED &) = default;
+	ED &operator=(ED &&) = default;
 	ED(short* gradImg, uchar *dirImg, int _width, int _height, int _gradThresh, int _anchorThresh, int _scanInterval = 1, int _minPathLen = 10, bool selectStableAnchors = true);
 	ED(EDColor &cpyObj);
 	ED();
@@ -59,13 +186,21 @@ public:
 	cv::Mat getAnchorImage();
 	cv::Mat getSmoothImage();
 	cv::Mat getGradImage();
+	float getGradScale(); // gradient map units per gradient unit of the input (1 for 8-bit input)
 	
 	int getSegmentNo();
 	int getAnchorNo();
 	
-	std::vector<cv::Point> getAnchorPoints();
-	std::vector<std::vector<cv::Point>> getSegments();
+	const std::vector<cv::Point> &getAnchorPoints();
+	std::vector<std::vector<cv::Point>> getSegments(); // copy of the segments as separate vectors
 	std::vector<std::vector<cv::Point>> getSortedSegments();
+
+	// Segments without copying: segment i is getSegmentList()[i], a view valid until the next detection
+	const EDSegments &getSegmentList();
+	// Moves the segments out of ED (which is left with no segments)
+	EDSegments takeSegments();
+	// The segments as Freeman chain codes, ~20x smaller than the cv::Point form (encoded on first use after a detection)
+	const EDChainCodes &getChainCodes();
 	
 	cv::Mat drawParticularSegments(std::vector<int> list);
 
@@ -73,7 +208,8 @@ protected:
 	int width; // width of source image
 	int height; // height of source image
 	uchar *srcImg; 
-	std::vector<std::vector< cv::Point> > segmentPoints;
+	EDSegments segmentPoints; // all segments in one flat (CSR) array, see EDSegments.h
+	EDChainCodes chainCodes; // chain coded segments; the only form of the segments if segmentPoints was dropped (see EDDetector::setChainCodeOutput)
 	double sigma; // Gaussian sigma
 	cv::Mat smoothImage;
 	uchar *edgeImg; // pointer to edge image data
@@ -81,13 +217,60 @@ protected:
 	int segmentNos;
 	int minPathLen;
 	cv::Mat srcImage;
+	EDWorkspace *workspace; // external scratch buffers (NULL if ED allocates its own per call)
+
+	GradientOperator op; // operation used in gradient calculation
+	double userGradThresh; // gradient threshold as given, in gradient units of the input
+	double userAnchorThresh; // anchor point threshold as given, in gradient units of the input
+	int gradThresh; // gradient threshold on the gradient map (see MapThreshold)
+	int anchorThresh; // anchor point threshold on the gradient map
+	int scanInterval;
+	bool sumFlag;
+	bool fusedPipeline; // smooth, compute gradient & anchors band by band (smoothImage is not kept); 8-bit images only
+	int bandHeight; // rows per band in the fused/parallel pipeline (0: chosen automatically)
+	ThreadPool *threadPool; // if set, gradient & anchors (and tiled linking) run in parallel on this pool
+	bool tiledLinking; // link anchors tile by tile and stitch segments across tile borders
+	int tileSize; // tile side in tiled linking (0: chosen automatically)
+	EDTileLinkStats tileStats;
+	size_t maxLinkMemory; // cap on the pixel, stack & chain buffers of a linking walk in bytes (0: no cap)
+	int noTruncatedWalks; // walks cut short by maxLinkMemory in the last detection
+	EDRegions regions; // detection is restricted to these parts of the image (empty: whole image)
+	std::vector<cv::Rect> regionRects; // the regions as disjoint rectangles inside the image (empty: whole image)
+	bool presmoothed; // smoothImage already holds the smoothed frame (region mode only)
+	bool smoothedInFull; // smoothImage holds the whole smoothed frame (not kept by the fused pipeline; only around the regions in region & pyramid modes)
+	const EDSegments *keptSegments; // segments carried over from an earlier frame: drawn into the edge map before linking & listed first (NULL: none)
+	float gradScale; // 16-bit & float input: gradients are multiplied by this to fit the gradient map (1 for 8-bit input)
+	EDSegmentSink *segmentSink; // receives each segment once it is final (NULL: none); not owned
+
+	void DetectEdges();
+	std::vector<EDSegments> DetectSweep(const std::vector<EDSweepParams> &params);
+	void ComputeRegionRects();
+	void SmoothRegions(cv::Size ksize, double sigma, int margin);
+	bool InRegion(int r, int c);
+	void ConvertTo8Bit();
+	void ShareResults(const ED &cpyObj);
+	void DetachEdgeImage();
 
 private:
+	void InitOptions();
+	void AllocateImages(EDWorkspace *ws, bool fused);
 	void ComputeGradient();
+	void ComputeGradientRect(int row, int noRows, int colStart = 1, int colEnd = -1);
+	float ComputeGradScale();
+	int MapThreshold(double thresh, int minThresh);
 	void ComputeAnchorPoints();
-	void JoinAnchorPointsUsingSortedAnchors(); 
+	void InitGradientBorders();
+	void ComputeAnchorRows(int rowStart, int rowEnd, std::vector<cv::Point> &anchors, int colStart = 2, int colEnd = -1);
+	void DetectEdgesInRegions();
+	void ComputeGradientAndAnchorsByBands(EDWorkspace *ws);
+	void ComputeGradientAndAnchorsParallel(EDWorkspace *ws, bool fused);
+	void JoinAnchorPointsUsingSortedAnchors(EDWorkspace *ws);
+	void JoinAnchorPointsByTiles(EDWorkspace *ws);
+	int LinkTile(int r0, int r1, int c0, int c1, EDWorkspace *ws, EDSegments &segments, std::vector<char> &shortFlags);
+	void StitchTileSegments(const EDSegments &segments, std::vector<char> &shortFlags, std::vector<int> &segmentTiles, int tileCols, int T);
+	bool TouchesTileBorder(cv::Point *pixels, int len);
 	void sortAnchorsByGradValue();
-	int* sortAnchorsByGradValue1();
+	int* sortAnchorsByGradValue1(EDWorkspace *ws);
 
 	static int LongestChain(Chain *chains, int root);
 	static int RetrieveChainNos(Chain *chains, int root, int chainNos[]);
@@ -102,11 +285,8 @@ private:
 	uchar *dirImg; // pointer to direction image data
 	short *gradImg; // pointer to gradient image data
 
-	GradientOperator op; // operation used in gradient calculation
-	int gradThresh; // gradient threshold
-	int anchorThresh; // anchor point threshold
-	int scanInterval;
-	bool sumFlag;
+	int tileSides; // for a tile being linked: internal borders (TILE_TOP | TILE_BOTTOM | TILE_LEFT | TILE_RIGHT)
+	std::vector<char> tileShortSegments; // for a tile being linked: segment kept only because its walk reached a tile border
 };
 
 
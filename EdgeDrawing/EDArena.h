@@ -0,0 +1,120 @@
+/**************************************************************************************************************
+* Arena of scratch memory for one detection.
+*
+* Memory is handed out from blocks that are allocated on demand and never move, so everything allocated stays
+* valid until the arena is reset, which frees it all in one step. A reset replaces the blocks of a detection that
+* needed more than one by a single block of their combined size, so an arena reused across frames (e.g. the one of
+* an EDWorkspace) stops allocating once it has seen the largest frame.
+**************************************************************************************************************/
+
+#ifndef _EDArena_
+#define _EDArena_
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <vector>
+
+class EDArena {
+public:
+	EDArena() : used(0) {}
+	~EDArena() { release(); }
+
+	// An arena only holds scratch memory: copies start empty
+	EDArena(const EDArena &) : used(0) {}
+	EDArena &operator=(const EDArena &) { return *this; }
+
+	// Uninitialized memory for count elements of T, aligned for any type
+	template <class T> T *allocate(int count) { return (T *)allocate(count * sizeof(T)); }
+
+	void *allocate(size_t bytes) {
+		bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		if (blocks.empty() || used + bytes > blocks.back().size) {
+			size_t size = blocks.empty() ? MIN_BLOCK_SIZE : 2 * blocks.back().size;
+			AddBlock(size < bytes ? bytes : size);
+		} //end-if
+
+		void *p = blocks.back().data + used;
+		used += bytes;
+		return p;
+	}
+
+	// Copies the first count elements of items to a new array of twice the capacity (items are plain data)
+	template <class T> T *grow(T *items, int count, int &capacity) {
+		capacity = capacity < 8 ? 16 : 2 * capacity;
+		T *newItems = allocate<T>(capacity);
+		if (count > 0) memcpy((void *)newItems, (const void *)items, count * sizeof(T));
+		return newItems;
+	}
+
+	// Frees everything allocated since the last reset
+	void reset() {
+		if (blocks.size() > 1) {
+			size_t total = 0;
+			for (size_t i = 0; i < blocks.size(); i++) total += blocks[i].size;
+			release();
+			AddBlock(total);
+		} //end-if
+		used = 0;
+	}
+
+	// Returns all memory to the system
+	void release() {
+		for (size_t i = 0; i < blocks.size(); i++) free(blocks[i].data);
+		blocks.clear();
+		used = 0;
+	}
+
+	size_t getAllocatedBytes() {
+		size_t total = 0;
+		for (size_t i = 0; i < blocks.size(); i++) total += blocks[i].size;
+		return total;
+	}
+
+private:
+	static const size_t ALIGNMENT = 16;
+	static const size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+	struct Block {
+		char *data;
+		size_t size;
+	};
+
+	void AddBlock(size_t size) {
+		Block block = { (char *)malloc(size), size };
+		if (block.data == NULL) throw std::bad_alloc();
+		blocks.push_back(block);
+		used = 0;
+	}
+
+	std::vector<Block> blocks;
+	size_t used; // bytes used in the last block
+};
+
+// Array in an EDArena that doubles its capacity when full. Elements move when the array grows,
+// so refer to them by index across additions.
+template <class T> struct EDArenaArray {
+	T *items;
+	int size;
+	int capacity;
+	EDArena *arena;
+
+	EDArenaArray() : items(NULL), size(0), capacity(0), arena(NULL) {}
+
+	void init(EDArena *_arena, int _capacity) {
+		arena = _arena;
+		capacity = _capacity < 16 ? 16 : _capacity;
+		items = arena->allocate<T>(capacity);
+		size = 0;
+	}
+
+	// Appends a default constructed element
+	T &add() {
+		if (size == capacity) items = arena->grow(items, size, capacity);
+		return *new (&items[size++]) T();
+	}
+
+	T &operator[](int i) { return items[i]; }
+};
+
+#endif
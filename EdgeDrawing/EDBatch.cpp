@@ -0,0 +1,71 @@
+#include "EDBatch.h"
+#include <atomic>
+
+using namespace cv;
+using namespace std;
+
+EDBatch::EDBatch(ThreadPool *_pool, int _stages, GradientOperator _op, double _gradThresh, double _anchorThresh, int _scanInterval, int _minPathLen, double _sigma, bool _sumFlag)
+{
+	pool = _pool;
+	stages = _stages;
+	op = _op;
+	gradThresh = _gradThresh;
+	anchorThresh = _anchorThresh;
+	scanInterval = _scanInterval;
+	minPathLen = _minPathLen;
+	sigma = _sigma;
+	sumFlag = _sumFlag;
+}
+
+vector<EDBatchResult> EDBatch::run(const vector<Mat> &images)
+{
+	return run((int)images.size(), [&images](int i) { return images[i]; });
+}
+
+vector<EDBatchResult> EDBatch::run(int count, const function<Mat(int)> &loader)
+{
+	vector<EDBatchResult> results(MAX(count, 0));
+	atomic<int> next(0);
+
+	// One task per worker, each with its own detector (and so its own workspace), pulling images until none are left
+	auto work = [this, count, &loader, &results, &next] {
+		EDDetector detector(op, gradThresh, anchorThresh, scanInterval, minPathLen, sigma, sumFlag);
+		for (int i = next++; i < count; i = next++) {
+			Mat image = loader(i);
+			if (!image.empty()) Detect(detector, image, results[i]);
+		} //end-for
+	};
+
+	int noTasks = pool ? MIN(pool->get_workers_num(), count) : 1;
+	if (noTasks <= 1) {
+		work();
+		return results;
+	} //end-if
+
+	vector<std::future<void>> futures;
+	futures.reserve(noTasks);
+	for (int t = 0; t < noTasks; t++) futures.push_back(pool->enqueue(work));
+
+	// All tasks use results & next, so wait for every one of them before passing on an error
+	WaitForTasks(futures);
+
+	return results;
+}
+
+void EDBatch::Detect(EDDetector &detector, const Mat &image, EDBatchResult &result)
+{
+	detector.detect(image);
+
+	if (stages & ED_BATCH_LINES) {
+		EDLines lines(detector);
+		result.lines = lines.getLines();
+	} //end-if
+
+	if (stages & ED_BATCH_CIRCLES) {
+		EDCircles circles(detector);
+		result.circles = circles.getCircles();
+		result.ellipses = circles.getEllipses();
+	} //end-if
+
+	result.segments = detector.takeSegments();
+}
@@ -0,0 +1,52 @@
+/**************************************************************************************************************
+* Batch Edge Drawing over many images.
+*
+* Runs ED, and optionally EDLines & EDCircles, on a list of images on a ThreadPool. Each worker pulls the next
+* image as soon as it is done with the last one and runs it on its own EDDetector, so every worker reuses a
+* single workspace for all its images. Results are returned in input order.
+**************************************************************************************************************/
+
+#ifndef _EDBatch_
+#define _EDBatch_
+
+#include "EDDetector.h"
+#include "EDLines.h"
+#include "EDCircles.h"
+
+// Stages run on every image of a batch (EDLines & EDCircles are built from the ED result)
+enum EDBatchStages { ED_BATCH_EDGES = 1, ED_BATCH_LINES = 2, ED_BATCH_CIRCLES = 4 };
+
+struct EDBatchResult {
+	EDSegments segments;
+	std::vector<LS> lines;            // ED_BATCH_LINES only
+	std::vector<mCircle> circles;     // ED_BATCH_CIRCLES only
+	std::vector<mEllipse> ellipses;   // ED_BATCH_CIRCLES only
+};
+
+class EDBatch {
+public:
+	// pool: workers to run on, not owned (NULL: serial). The remaining parameters are those of EDDetector.
+	EDBatch(ThreadPool *_pool, int _stages = ED_BATCH_EDGES, GradientOperator _op = PREWITT_OPERATOR, double _gradThresh = 20, double _anchorThresh = 0, int _scanInterval = 1, int _minPathLen = 10, double _sigma = 1.0, bool _sumFlag = true);
+
+	// Single channel 8-bit, 16-bit or float images; an empty image gives an empty result
+	std::vector<EDBatchResult> run(const std::vector<cv::Mat> &images);
+
+	// Images are produced by loader(i), i = 0 ... count-1, on the worker threads (e.g. imread of a file list),
+	// so loading overlaps with detection and only one image per worker is held at a time
+	std::vector<EDBatchResult> run(int count, const std::function<cv::Mat(int)> &loader);
+
+private:
+	void Detect(EDDetector &detector, const cv::Mat &image, EDBatchResult &result);
+
+	ThreadPool *pool;
+	int stages;
+	GradientOperator op;
+	double gradThresh;
+	double anchorThresh;
+	int scanInterval;
+	int minPathLen;
+	double sigma;
+	bool sumFlag;
+};
+
+#endif
@@ -0,0 +1,225 @@
+/**************************************************************************************************************
+* Freeman chain code storage of edge segments.
+*
+* Consecutive pixels of a segment are 8-neighbours, so a segment is stored as its first pixel followed by one
+* 3-bit direction code per step instead of one cv::Point (8 bytes) per pixel. The rare step between pixels
+* that are not neighbours starts a new run with its own start pixel, so any EDSegments is encoded exactly.
+*
+* Segments are read back pixel by pixel through EDChainCodeView, without expanding them to cv::Point arrays.
+**************************************************************************************************************/
+
+#ifndef _EDChainCodes_
+#define _EDChainCodes_
+
+#include "EDSegments.h"
+#include <string.h>
+
+// Freeman directions: 0 E, 1 NE, 2 N, 3 NW, 4 W, 5 SW, 6 S, 7 SE (y grows downwards)
+static const int ED_CHAIN_DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int ED_CHAIN_DY[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+class EDChainCodes;
+
+// Read-only view of one chain coded segment
+class EDChainCodeView {
+public:
+	class iterator {
+	public:
+		iterator(const EDChainCodes *_codes, int _run, int _runEnd);
+
+		cv::Point operator*() const { return p; }
+		iterator &operator++();
+		bool operator==(const iterator &it) const { return run == it.run && step == it.step; }
+		bool operator!=(const iterator &it) const { return !(*this == it); }
+
+	private:
+		const EDChainCodes *codes;
+		int run, runEnd;   // current run & one past the last run of the segment
+		int step, stepEnd; // current step & one past the last step of the run
+		cv::Point p;
+	};
+
+	EDChainCodeView(const EDChainCodes *_codes, int _firstRun, int _runEnd, int _len) : codes(_codes), firstRun(_firstRun), runEnd(_runEnd), len(_len) {}
+
+	int size() const { return len; }
+	bool empty() const { return len == 0; }
+	iterator begin() const { return iterator(codes, firstRun, runEnd); }
+	iterator end() const { return iterator(codes, runEnd, runEnd); }
+
+	// Writes the first count pixels (all if count < 0) to pixels[0 ... count-1]
+	void decode(cv::Point *pixels, int count = -1) const {
+		if (count < 0 || count > len) count = len;
+		iterator it = begin();
+		for (int i = 0; i < count; i++, ++it) pixels[i] = *it;
+	}
+
+private:
+	const EDChainCodes *codes;
+	int firstRun, runEnd;
+	int len;
+};
+
+class EDChainCodes {
+public:
+	EDChainCodes() { clear(); }
+	EDChainCodes(const EDSegments &segments) { assign(segments); }
+
+	// Number of segments
+	int size() const { return (int)segmentRuns.size() - 1; }
+	bool empty() const { return size() == 0; }
+
+	EDChainCodeView operator[](int i) const {
+		int r0 = segmentRuns[i], r1 = segmentRuns[i + 1];
+		return EDChainCodeView(this, r0, r1, runSteps[r1] - runSteps[r0] + (r1 - r0));
+	}
+
+	void clear() {
+		runStarts.clear();
+		runSteps.assign(1, 0);
+		segmentRuns.assign(1, 0);
+		codes.assign(1, 0);
+		noSteps = 0;
+	}
+
+	// Appends a segment
+	void append(EDSegmentView segment) {
+		if (segment.empty()) { segmentRuns.push_back(segmentRuns.back()); return; }
+
+		runStarts.push_back(segment[0]);
+		for (int i = 1; i < segment.size(); i++) {
+			int dx = segment[i].x - segment[i - 1].x, dy = segment[i].y - segment[i - 1].y;
+			int code = dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1 ? DirectionCode(dx, dy) : -1;
+
+			if (code >= 0) {
+				addCode(code);
+			}
+			else {
+				// not a neighbour: new run
+				runSteps.push_back(noSteps);
+				runStarts.push_back(segment[i]);
+			} //end-else
+		} //end-for
+
+		runSteps.push_back(noSteps);
+		segmentRuns.push_back((int)runStarts.size());
+	}
+
+	void assign(const EDSegments &segments) {
+		clear();
+		for (int i = 0; i < segments.size(); i++) append(segments[i]);
+	}
+
+	EDSegments decode() const {
+		EDSegments segments;
+		segments.reserve(totalPoints(), size());
+		for (int i = 0; i < size(); i++) {
+			EDChainCodeView segment = (*this)[i];
+			for (EDChainCodeView::iterator it = segment.begin(); it != segment.end(); ++it) segments.addPoint(*it);
+			segments.closeSegment();
+		} //end-for
+		return segments;
+	}
+
+	int totalPoints() const { return noSteps + (int)runStarts.size(); }
+	size_t memoryBytes() const { return runStarts.size()*sizeof(cv::Point) + (runSteps.size() + segmentRuns.size())*sizeof(int) + codes.size(); }
+
+	// Flat byte stream for archiving & transfer: counts, then the raw arrays (native byte order)
+	std::vector<uchar> serialize() const {
+		int header[3] = { (int)runStarts.size(), size(), (int)codes.size() };
+		std::vector<uchar> bytes;
+		put(bytes, header, sizeof(header));
+		put(bytes, runStarts.data(), runStarts.size()*sizeof(cv::Point));
+		put(bytes, runSteps.data(), runSteps.size()*sizeof(int));
+		put(bytes, segmentRuns.data(), segmentRuns.size()*sizeof(int));
+		put(bytes, codes.data(), codes.size());
+		return bytes;
+	}
+
+	// Inverse of serialize; returns false (and leaves no segments) if data is not a valid stream
+	bool deserialize(const uchar *data, size_t length) {
+		clear();
+		int header[3];
+		if (length < sizeof(header)) return false;
+		memcpy(header, data, sizeof(header));
+
+		size_t noRuns = header[0], noSegments = header[1], noCodes = header[2];
+		if (header[0] < 0 || header[1] < 0 || header[2] < 1 ||
+			length != sizeof(header) + noRuns*sizeof(cv::Point) + (noRuns + 1 + noSegments + 1)*sizeof(int) + noCodes) return false;
+
+		const uchar *p = data + sizeof(header);
+		runStarts.resize(noRuns);       p = get(p, runStarts.data(), noRuns*sizeof(cv::Point));
+		runSteps.resize(noRuns + 1);    p = get(p, runSteps.data(), (noRuns + 1)*sizeof(int));
+		segmentRuns.resize(noSegments + 1); p = get(p, segmentRuns.data(), (noSegments + 1)*sizeof(int));
+		codes.resize(noCodes);          get(p, codes.data(), noCodes);
+
+		// offsets must be ordered & in range
+		bool valid = runSteps[0] == 0 && segmentRuns[0] == 0 && segmentRuns[noSegments] == (int)noRuns;
+		for (size_t r = 0; r < noRuns && valid; r++) valid = runSteps[r] <= runSteps[r + 1];
+		for (size_t i = 0; i < noSegments && valid; i++) valid = segmentRuns[i] <= segmentRuns[i + 1];
+		if (valid && runSteps[noRuns] > 0) valid = (size_t)(3 * (runSteps[noRuns] - 1)) / 8 + 2 <= noCodes;
+		if (!valid) { clear(); return false; }
+
+		noSteps = runSteps[noRuns];
+		return true;
+	}
+
+	// Direction code of step i (global step index)
+	int code(int i) const {
+		int bit = 3 * i;
+		return ((codes[bit >> 3] | (codes[(bit >> 3) + 1] << 8)) >> (bit & 7)) & 7;
+	}
+
+	// Raw arrays: start pixel & first step of each run, first run of each segment
+	const cv::Point *getRunStarts() const { return runStarts.data(); }
+	const int *getRunSteps() const { return runSteps.data(); }
+	const int *getSegmentRuns() const { return segmentRuns.data(); }
+
+	static int DirectionCode(int dx, int dy) {
+		static const int table[9] = { 3, 2, 1, 4, -1, 0, 5, 6, 7 }; // (dy+1)*3 + (dx+1)
+		return table[(dy + 1) * 3 + dx + 1];
+	}
+
+private:
+	void addCode(int c) {
+		int bit = 3 * noSteps;
+		if ((size_t)(bit >> 3) + 2 > codes.size()) codes.resize((bit >> 3) + 2, 0); // one byte of padding for code()
+		int v = c << (bit & 7);
+		codes[bit >> 3] |= (uchar)v;
+		codes[(bit >> 3) + 1] |= (uchar)(v >> 8);
+		noSteps++;
+	}
+
+	static void put(std::vector<uchar> &bytes, const void *data, size_t size) { bytes.insert(bytes.end(), (const uchar *)data, (const uchar *)data + size); }
+	static const uchar *get(const uchar *p, void *data, size_t size) { memcpy(data, p, size); return p + size; }
+
+	std::vector<cv::Point> runStarts;
+	std::vector<int> runSteps;    // runs+1 entries: steps of run r are [runSteps[r], runSteps[r+1])
+	std::vector<int> segmentRuns; // segments+1 entries: runs of segment i are [segmentRuns[i], segmentRuns[i+1])
+	std::vector<uchar> codes;     // 3 bits per step, packed
+	int noSteps;
+};
+
+inline EDChainCodeView::iterator::iterator(const EDChainCodes *_codes, int _run, int _runEnd)
+	: codes(_codes), run(_run), runEnd(_runEnd)
+{
+	step = codes->getRunSteps()[run];
+	stepEnd = run < runEnd ? codes->getRunSteps()[run + 1] : step;
+	if (run < runEnd) p = codes->getRunStarts()[run];
+}
+
+inline EDChainCodeView::iterator &EDChainCodeView::iterator::operator++()
+{
+	if (step < stepEnd) {
+		int c = codes->code(step++);
+		p.x += ED_CHAIN_DX[c];
+		p.y += ED_CHAIN_DY[c];
+	}
+	else if (++run < runEnd) {
+		p = codes->getRunStarts()[run];
+		stepEnd = codes->getRunSteps()[run + 1];
+	} //end-else
+
+	return *this;
+}
+
+#endif
@@ -6,499 +6,61 @@ using namespace std;
 EDCircles::EDCircles(Mat srcImage)
 	: EDPF(srcImage)
 {
-	// Arcs & circles to be detected
-	// If the end-points of the segment is very close to each other, 
-	// then directly fit a circle/ellipse instread of line fitting
-	noCircles1 = 0;
-	circles1 = new Circle[(width + height) * 8];
-
-	// ----------------------------------- DETECT LINES ---------------------------------
-	int bufferSize = 0;
-	for (int i = 0; i < segmentPoints.size(); i++)
-		bufferSize += static_cast<int>(segmentPoints[i].size());
-
-	// Compute the starting line number for each segment
-	segmentStartLines = new int[segmentNos + 1];
-
-	bm = new BufferManager(bufferSize * 8);
-	vector<LineSegment> lines;
-
-
-#define CIRCLE_MIN_LINE_LEN 6
-
-	for (int i = 0; i < segmentNos; i++)
-	{
-		// Make note of the starting line number for this segment
-		segmentStartLines[i] = static_cast<int>(lines.size());
-
-		int noPixels = static_cast<int>(segmentPoints[i].size());
-
-		if (noPixels < 2 * CIRCLE_MIN_LINE_LEN)
-			continue;
-
-		double* x = bm->getX();
-		double* y = bm->getY();
-
-		for (int j = 0; j < noPixels; j++)
-		{
-			x[j] = segmentPoints[i][j].x;
-			y[j] = segmentPoints[i][j].y;
-		} //end-for
-
-		// If the segment is reasonably long, then see if the segment traverses the boundary of a closed shape
-		if (noPixels >= 4 * CIRCLE_MIN_LINE_LEN)
-		{
-			// If the end-points of the segment is close to each other, then assume a circular/elliptic structure
-			double dx = x[0] - x[noPixels - 1];
-			double dy = y[0] - y[noPixels - 1];
-			double d = sqrt(dx * dx + dy * dy);
-			double r = noPixels / TWOPI; // Assume a complete circle
-
-			double maxDistanceBetweenEndPoints = MAX(3, r / 4);
-
-			// If almost closed loop, then try to fit a circle/ellipse
-			if (d <= maxDistanceBetweenEndPoints)
-			{
-				double xc, yc, r, circleFitError = 1e10;
-
-				CircleFit(x, y, noPixels, &xc, &yc, &r, &circleFitError);
-
-				EllipseEquation eq;
-				double ellipseFitError = 1e10;
-
-				if (circleFitError > LONG_ARC_ERROR)
-				{
-					// Try fitting an ellipse
-					if (EllipseFit(x, y, noPixels, &eq))
-						ellipseFitError = ComputeEllipseError(&eq, x, y, noPixels);
-				} //end-if
-
-				if (circleFitError <= LONG_ARC_ERROR)
-				{
-					addCircle(circles1, noCircles1, xc, yc, r, circleFitError, x, y, noPixels);
-					bm->move(noPixels);
-					continue;
-				}
-				if (ellipseFitError <= ELLIPSE_ERROR)
-				{
-					double major, minor;
-					ComputeEllipseCenterAndAxisLengths(&eq, &xc, &yc, &major, &minor);
-
-					// Assume major is longer. Otherwise, swap
-					if (minor > major)
-					{
-						double tmp = major;
-						major = minor;
-						minor = tmp;
-					}
-
-					if (major < 8 * minor)
-					{
-						addCircle(circles1, noCircles1, xc, yc, r, circleFitError, &eq, ellipseFitError, x, y,
-						          noPixels);
-						bm->move(noPixels);
-					} //end-if
-
-					continue;
-				}
-				//end-else
-			} //end-if 
-		} //end-if
-
-		// Otherwise, split to lines
-		EDLines::SplitSegment2Lines(x, y, noPixels, i, lines);
-	}
-
-	segmentStartLines[segmentNos] = static_cast<int>(lines.size());
-
-	// ------------------------------- DETECT ARCS ---------------------------------
-
-	info = new Info[lines.size()];
-
-	// Compute the angle information for each line segment
-	for (int i = 0; i < segmentNos; i++)
-	{
-		for (int j = segmentStartLines[i]; j < segmentStartLines[i + 1]; j++)
-		{
-			LineSegment* l1 = &lines[j];
-			LineSegment* l2;
-
-			if (j == segmentStartLines[i + 1] - 1) l2 = &lines[segmentStartLines[i]];
-			else l2 = &lines[j + 1];
-
-#if 1
-			// If the end points of the lines are far from each other, then stop at this line
-			double dx = l1->ex - l2->sx;
-			double dy = l1->ey - l2->sy;
-			double d = sqrt(dx * dx + dy * dy);
-			if (d >= 15)
-			{
-				info[j].angle = 10;
-				info[j].sign = 2;
-				info[j].taken = false;
-				continue;
-			}
-#endif
-
-			// Compute the angle between the lines & their turn direction
-			double v1x = l1->ex - l1->sx;
-			double v1y = l1->ey - l1->sy;
-			double v1Len = sqrt(v1x * v1x + v1y * v1y);
-
-			double v2x = l2->ex - l2->sx;
-			double v2y = l2->ey - l2->sy;
-			double v2Len = sqrt(v2x * v2x + v2y * v2y);
-
-			double dotProduct = (v1x * v2x + v1y * v2y) / (v1Len * v2Len);
-			if (dotProduct > 1.0) dotProduct = 1.0;
-			else if (dotProduct < -1.0) dotProduct = -1.0;
-
-			info[j].angle = acos(dotProduct);
-			info[j].sign = (v1x * v2y - v2x * v1y) >= 0 ? 1 : -1; // compute cross product
-			info[j].taken = false;
-		} //end-for
-	} //end-for
-
-	// This is how much space we will allocate for circles buffers
-	int maxNoOfCircles = static_cast<int>(lines.size()) / 3 + noCircles1 * 2;
-
-	edarcs1 = new EDArcs(maxNoOfCircles);
-	DetectArcs(lines); // Detect all arcs
-
-	// Try to join arcs that are almost perfectly circular. 
-	// Use the distance between the arc end-points as a metric in choosing in choosing arcs to join
-	edarcs2 = new EDArcs(maxNoOfCircles);
-	JoinArcs1();
-
-	// Try to join arcs that belong to the same segment
-	edarcs3 = new EDArcs(maxNoOfCircles);
-	JoinArcs2();
-
-	// Try to combine arcs that belong to different segments
-	edarcs4 = new EDArcs(maxNoOfCircles); // The remaining arcs
-	JoinArcs3();
-
-	// Finally, go over the arcs & circles, and generate candidate circles
-	GenerateCandidateCircles();
-
-	//----------------------------- VALIDATE CIRCLES --------------------------
-	noCircles2 = 0;
-	circles2 = new Circle[maxNoOfCircles];
-	GaussianBlur(srcImage, smoothImage, Size(), 0.50); // calculate kernel from sigma;
-
-	ValidateCircles();
-
-	//----------------------------- JOIN CIRCLES --------------------------
-	noCircles3 = 0;
-	circles3 = new Circle[maxNoOfCircles];
-	JoinCircles();
-
-	noCircles = 0;
-	noEllipses = 0;
-	for (int i = 0; i < noCircles3; i++)
-	{
-		if (circles3[i].isEllipse)
-			noEllipses++;
-		else
-			noCircles++;
-	}
-
-	for (int i = 0; i < noCircles3; i++)
-	{
-		if (circles3[i].isEllipse)
-		{
-			EllipseEquation eq = circles3[i].eq;
-			double xc;
-			double yc;
-			double a;
-			double b;
-			double theta = ComputeEllipseCenterAndAxisLengths(&eq, &xc, &yc, &a, &b);
-			ellipses.push_back(mEllipse(Point2d(xc, yc), Size2d(a, b), theta));
-		}
-		else
-		{
-			double r = circles3[i].r;
-			double xc = circles3[i].xc;
-			double yc = circles3[i].yc;
-
-			circles.push_back(mCircle(Point2d(xc, yc), r));
-		} //end-else
-	} //end-for
-
-
-	// clean up
-	delete edarcs1;
-	delete edarcs2;
-	delete edarcs3;
-	delete edarcs4;
-
-	delete[] circles1;
-	delete[] circles2;
-	delete[] circles3;
+	DetectCircles(true);
+}
 
-	delete bm;
-	delete[] segmentStartLines;
-	delete[] info;
+// Circles & ellipses inside the given regions only (see EDRegions)
+EDCircles::EDCircles(Mat srcImage, const EDRegions &regions)
+	: EDCircles(ED(srcImage, regions, PREWITT_OPERATOR, 11, 3))
+{
 }
 
 EDCircles::EDCircles(ED obj)
-	: EDPF(obj)
+	: EDPF(std::move(obj))
 {
-	// Arcs & circles to be detected
-	// If the end-points of the segment is very close to each other, 
-	// then directly fit a circle/ellipse instread of line fitting
-	noCircles1 = 0;
-	circles1 = new Circle[(width + height) * 8];
-
-	// ----------------------------------- DETECT LINES ---------------------------------
-	int bufferSize = 0;
-	for (int i = 0; i < segmentPoints.size(); i++)
-		bufferSize += static_cast<int>(segmentPoints[i].size());
-
-	// Compute the starting line number for each segment
-	segmentStartLines = new int[segmentNos + 1];
-
-	bm = new BufferManager(bufferSize * 8);
-	vector<LineSegment> lines;
-
-
-#define CIRCLE_MIN_LINE_LEN 6
-
-	for (int i = 0; i < segmentNos; i++)
-	{
-		// Make note of the starting line number for this segment
-		segmentStartLines[i] = static_cast<int>(lines.size());
-
-		int noPixels = static_cast<int>(segmentPoints[i].size());
-
-		if (noPixels < 2 * CIRCLE_MIN_LINE_LEN)
-			continue;
-
-		double* x = bm->getX();
-		double* y = bm->getY();
-
-		for (int j = 0; j < noPixels; j++)
-		{
-			x[j] = segmentPoints[i][j].x;
-			y[j] = segmentPoints[i][j].y;
-		} //end-for
-
-		// If the segment is reasonably long, then see if the segment traverses the boundary of a closed shape
-		if (noPixels >= 4 * CIRCLE_MIN_LINE_LEN)
-		{
-			// If the end-points of the segment is close to each other, then assume a circular/elliptic structure
-			double dx = x[0] - x[noPixels - 1];
-			double dy = y[0] - y[noPixels - 1];
-			double d = sqrt(dx * dx + dy * dy);
-			double r = noPixels / TWOPI; // Assume a complete circle
-
-			double maxDistanceBetweenEndPoints = MAX(3, r / 4);
-
-			// If almost closed loop, then try to fit a circle/ellipse
-			if (d <= maxDistanceBetweenEndPoints)
-			{
-				double xc, yc, r, circleFitError = 1e10;
-
-				CircleFit(x, y, noPixels, &xc, &yc, &r, &circleFitError);
-
-				EllipseEquation eq;
-				double ellipseFitError = 1e10;
-
-				if (circleFitError > LONG_ARC_ERROR)
-				{
-					// Try fitting an ellipse
-					if (EllipseFit(x, y, noPixels, &eq))
-						ellipseFitError = ComputeEllipseError(&eq, x, y, noPixels);
-				} //end-if
-
-				if (circleFitError <= LONG_ARC_ERROR)
-				{
-					addCircle(circles1, noCircles1, xc, yc, r, circleFitError, x, y, noPixels);
-					bm->move(noPixels);
-					continue;
-				}
-				if (ellipseFitError <= ELLIPSE_ERROR)
-				{
-					double major, minor;
-					ComputeEllipseCenterAndAxisLengths(&eq, &xc, &yc, &major, &minor);
-
-					// Assume major is longer. Otherwise, swap
-					if (minor > major)
-					{
-						double tmp = major;
-						major = minor;
-						minor = tmp;
-					}
-
-					if (major < 8 * minor)
-					{
-						addCircle(circles1, noCircles1, xc, yc, r, circleFitError, &eq, ellipseFitError, x, y,
-						          noPixels);
-						bm->move(noPixels);
-					} //end-if
-
-					continue;
-				}
-				//end-else
-			} //end-if 
-		} //end-if
-
-		// Otherwise, split to lines
-		EDLines::SplitSegment2Lines(x, y, noPixels, i, lines);
-	}
-
-	segmentStartLines[segmentNos] = static_cast<int>(lines.size());
-
-	// ------------------------------- DETECT ARCS ---------------------------------
-
-	info = new Info[lines.size()];
-
-	// Compute the angle information for each line segment
-	for (int i = 0; i < segmentNos; i++)
-	{
-		for (int j = segmentStartLines[i]; j < segmentStartLines[i + 1]; j++)
-		{
-			LineSegment* l1 = &lines[j];
-			LineSegment* l2;
-
-			if (j == segmentStartLines[i + 1] - 1) l2 = &lines[segmentStartLines[i]];
-			else l2 = &lines[j + 1];
-
-#if 1
-			// If the end points of the lines are far from each other, then stop at this line
-			double dx = l1->ex - l2->sx;
-			double dy = l1->ey - l2->sy;
-			double d = sqrt(dx * dx + dy * dy);
-			if (d >= 15)
-			{
-				info[j].angle = 10;
-				info[j].sign = 2;
-				info[j].taken = false;
-				continue;
-			}
-#endif
-
-			// Compute the angle between the lines & their turn direction
-			double v1x = l1->ex - l1->sx;
-			double v1y = l1->ey - l1->sy;
-			double v1Len = sqrt(v1x * v1x + v1y * v1y);
-
-			double v2x = l2->ex - l2->sx;
-			double v2y = l2->ey - l2->sy;
-			double v2Len = sqrt(v2x * v2x + v2y * v2y);
-
-			double dotProduct = (v1x * v2x + v1y * v2y) / (v1Len * v2Len);
-			if (dotProduct > 1.0) dotProduct = 1.0;
-			else if (dotProduct < -1.0) dotProduct = -1.0;
-
-			info[j].angle = acos(dotProduct);
-			info[j].sign = (v1x * v2y - v2x * v1y) >= 0 ? 1 : -1; // compute cross product
-			info[j].taken = false;
-		} //end-for
-	} //end-for
-
-	// This is how much space we will allocate for circles buffers
-	int maxNoOfCircles = static_cast<int>(lines.size()) / 3 + noCircles1 * 2;
-
-	edarcs1 = new EDArcs(maxNoOfCircles);
-	DetectArcs(lines); // Detect all arcs
-
-	// Try to join arcs that are almost perfectly circular. 
-	// Use the distance between the arc end-points as a metric in choosing in choosing arcs to join
-	edarcs2 = new EDArcs(maxNoOfCircles);
-	JoinArcs1();
-
-	// Try to join arcs that belong to the same segment
-	edarcs3 = new EDArcs(maxNoOfCircles);
-	JoinArcs2();
-
-	// Try to combine arcs that belong to different segments
-	edarcs4 = new EDArcs(maxNoOfCircles); // The remaining arcs
-	JoinArcs3();
-
-	// Finally, go over the arcs & circles, and generate candidate circles
-	GenerateCandidateCircles();
-
-	//----------------------------- VALIDATE CIRCLES --------------------------
-	noCircles2 = 0;
-	circles2 = new Circle[maxNoOfCircles];
-	GaussianBlur(srcImage, smoothImage, Size(), 0.50); // calculate kernel from sigma;
-
-	ValidateCircles();
-
-	//----------------------------- JOIN CIRCLES --------------------------
-	noCircles3 = 0;
-	circles3 = new Circle[maxNoOfCircles];
-	JoinCircles();
-
-	noCircles = 0;
-	noEllipses = 0;
-	for (int i = 0; i < noCircles3; i++)
-	{
-		if (circles3[i].isEllipse)
-			noEllipses++;
-		else
-			noCircles++;
-	}
-
-	for (int i = 0; i < noCircles3; i++)
-	{
-		if (circles3[i].isEllipse)
-		{
-			EllipseEquation eq = circles3[i].eq;
-			double xc;
-			double yc;
-			double a;
-			double b;
-			double theta = ComputeEllipseCenterAndAxisLengths(&eq, &xc, &yc, &a, &b);
-			ellipses.push_back(mEllipse(Point2d(xc, yc), Size2d(a, b), theta));
-		}
-		else
-		{
-			double r = circles3[i].r;
-			double xc = circles3[i].xc;
-			double yc = circles3[i].yc;
-
-			circles.push_back(mCircle(Point2d(xc, yc), r));
-		} //end-else
-	} //end-for
-
-
-	// clean up
-	delete edarcs1;
-	delete edarcs2;
-	delete edarcs3;
-	delete edarcs4;
-
-	delete[] circles1;
-	delete[] circles2;
-	delete[] circles3;
-
-	delete bm;
-	delete[] segmentStartLines;
-	delete[] info;
+	DetectCircles(true);
 }
 
 EDCircles::EDCircles(EDColor obj)
 	: EDPF(obj)
 {
+	// EDCircles does not use validation when constructed wia EDColor object.
+	// TODO :: apply validation to color image 
+	DetectCircles(false);
+}
+
+//-----------------------------------------------------------------------------------------
+// Detects circles & ellipses in the segments of ED (validate: by NFA, then joined; otherwise all candidates are kept)
+//
+void EDCircles::DetectCircles(bool validate)
+{
+	// All buffers below come from one arena that starts small, grows on demand & is freed in one step at the end
+	arena = workspace ? workspace->getArena() : &ownArena;
+	arena->reset();
+
 	// Arcs & circles to be detected
 	// If the end-points of the segment is very close to each other, 
 	// then directly fit a circle/ellipse instread of line fitting
-	noCircles1 = 0;
-	circles1 = new Circle[(width + height) * 8];
+	circles1.init(arena, segmentNos / 8);
 
 	// ----------------------------------- DETECT LINES ---------------------------------
 	int bufferSize = 0;
-	for (int i = 0; i < segmentPoints.size(); i++)
+	int maxSegmentSize = 0;
+	for (int i = 0; i < segmentPoints.size(); i++) {
 		bufferSize += static_cast<int>(segmentPoints[i].size());
+		maxSegmentSize = MAX(maxSegmentSize, static_cast<int>(segmentPoints[i].size()));
+	} //end-for
 
 	// Compute the starting line number for each segment
-	segmentStartLines = new int[segmentNos + 1];
+	segmentStartLines = arena->allocate<int>(segmentNos + 1);
 
-	bm = new BufferManager(bufferSize * 8);
+	bm.init(arena, bufferSize);
 	vector<LineSegment> lines;
 
+	// Line splitting works on doubles
+	double *lineX = arena->allocate<double>(maxSegmentSize);
+	double *lineY = arena->allocate<double>(maxSegmentSize);
+
 
 #define CIRCLE_MIN_LINE_LEN 6
 
@@ -512,13 +74,14 @@ EDCircles::EDCircles(EDColor obj)
 		if (noPixels < 2 * CIRCLE_MIN_LINE_LEN)
 			continue;
 
-		double* x = bm->getX();
-		double* y = bm->getY();
+		bm.reserve(noPixels);
+		float* x = bm.getX();
+		float* y = bm.getY();
 
 		for (int j = 0; j < noPixels; j++)
 		{
-			x[j] = segmentPoints[i][j].x;
-			y[j] = segmentPoints[i][j].y;
+			x[j] = lineX[j] = segmentPoints[i][j].x;
+			y[j] = lineY[j] = segmentPoints[i][j].y;
 		} //end-for
 
 		// If the segment is reasonably long, then see if the segment traverses the boundary of a closed shape
@@ -551,8 +114,8 @@ EDCircles::EDCircles(EDColor obj)
 
 				if (circleFitError <= LONG_ARC_ERROR)
 				{
-					addCircle(circles1, noCircles1, xc, yc, r, circleFitError, x, y, noPixels);
-					bm->move(noPixels);
+					addCircle(circles1, xc, yc, r, circleFitError, x, y, noPixels);
+					bm.move(noPixels);
 					continue;
 				}
 				if (ellipseFitError <= ELLIPSE_ERROR)
@@ -570,9 +133,9 @@ EDCircles::EDCircles(EDColor obj)
 
 					if (major < 8 * minor)
 					{
-						addCircle(circles1, noCircles1, xc, yc, r, circleFitError, &eq, ellipseFitError, x, y,
+						addCircle(circles1, xc, yc, r, circleFitError, &eq, ellipseFitError, x, y,
 						          noPixels);
-						bm->move(noPixels);
+						bm.move(noPixels);
 					} //end-if
 
 					continue;
@@ -582,14 +145,14 @@ EDCircles::EDCircles(EDColor obj)
 		} //end-if
 
 		// Otherwise, split to lines
-		EDLines::SplitSegment2Lines(x, y, noPixels, i, lines);
+		EDLines::SplitSegment2Lines(lineX, lineY, noPixels, i, lines);
 	}
 
 	segmentStartLines[segmentNos] = static_cast<int>(lines.size());
 
 	// ------------------------------- DETECT ARCS ---------------------------------
 
-	info = new Info[lines.size()];
+	info = arena->allocate<Info>(static_cast<int>(lines.size()));
 
 	// Compute the angle information for each line segment
 	for (int i = 0; i < segmentNos; i++)
@@ -636,58 +199,57 @@ EDCircles::EDCircles(EDColor obj)
 	} //end-for
 
 	// This is how much space we will allocate for circles buffers
-	int maxNoOfCircles = static_cast<int>(lines.size()) / 3 + noCircles1 * 2;
+	int maxNoOfCircles = static_cast<int>(lines.size()) / 3 + circles1.size * 2;
 
-	edarcs1 = new EDArcs(maxNoOfCircles);
+	edarcs1.init(arena, maxNoOfCircles);
 	DetectArcs(lines); // Detect all arcs
 
 	// Try to join arcs that are almost perfectly circular. 
 	// Use the distance between the arc end-points as a metric in choosing in choosing arcs to join
-	edarcs2 = new EDArcs(maxNoOfCircles);
+	edarcs2.init(arena, maxNoOfCircles);
 	JoinArcs1();
 
 	// Try to join arcs that belong to the same segment
-	edarcs3 = new EDArcs(maxNoOfCircles);
+	edarcs3.init(arena, maxNoOfCircles);
 	JoinArcs2();
 
 	// Try to combine arcs that belong to different segments
-	edarcs4 = new EDArcs(maxNoOfCircles); // The remaining arcs
+	edarcs4.init(arena, maxNoOfCircles); // The remaining arcs
 	JoinArcs3();
 
 	// Finally, go over the arcs & circles, and generate candidate circles
 	GenerateCandidateCircles();
 
-	// EDCircles does not use validation when constructed wia EDColor object.
-	// TODO :: apply validation to color image 
-
-	//----------------------------- VALIDATE CIRCLES --------------------------
-	//noCircles2 = 0;
-	//circles2 = new Circle[maxNoOfCircles];
-	//GaussianBlur(srcImage, smoothImage, Size(), 0.50); // calculate kernel from sigma;
-
-	//ValidateCircles();
+	EDArenaArray<Circle> &result = validate ? circles3 : circles1;
+	if (validate)
+	{
+		//----------------------------- VALIDATE CIRCLES --------------------------
+		circles2.init(arena, maxNoOfCircles);
+		GaussianBlur(this->srcImage, smoothImage, Size(), 0.50); // calculate kernel from sigma;
+		smoothImg = smoothImage.data; // smoothImage is (re)allocated if the fused pipeline did not keep it
 
-	//----------------------------- JOIN CIRCLES --------------------------
-	//noCircles3 = 0;
-	//circles3 = new Circle[maxNoOfCircles];
-	//JoinCircles();
+		ValidateCircles();
 
+		//----------------------------- JOIN CIRCLES --------------------------
+		circles3.init(arena, maxNoOfCircles);
+		JoinCircles();
+	} //end-if
 
 	noCircles = 0;
 	noEllipses = 0;
-	for (int i = 0; i < noCircles1; i++)
+	for (int i = 0; i < result.size; i++)
 	{
-		if (circles1[i].isEllipse)
+		if (result[i].isEllipse)
 			noEllipses++;
 		else
 			noCircles++;
 	}
 
-	for (int i = 0; i < noCircles1; i++)
+	for (int i = 0; i < result.size; i++)
 	{
-		if (circles1[i].isEllipse)
+		if (result[i].isEllipse)
 		{
-			EllipseEquation eq = circles1[i].eq;
+			EllipseEquation eq = result[i].eq;
 			double xc;
 			double yc;
 			double a;
@@ -697,28 +259,23 @@ EDCircles::EDCircles(EDColor obj)
 		}
 		else
 		{
-			double r = circles1[i].r;
-			double xc = circles1[i].xc;
-			double yc = circles1[i].yc;
+			double r = result[i].r;
+			double xc = result[i].xc;
+			double yc = result[i].yc;
 
 			circles.push_back(mCircle(Point2d(xc, yc), r));
 		} //end-else
 	} //end-for
 
 
-	// clean up
-	delete edarcs1;
-	delete edarcs2;
-	delete edarcs3;
-	delete edarcs4;
-
-	delete[] circles1;
-	//delete[] circles2;
-	//delete[] circles3;
-
-	delete bm;
-	delete[] segmentStartLines;
-	delete[] info;
+	// clean up: the workspace's arena is kept for the next detection
+	circles1 = circles2 = circles3 = EDArenaArray<Circle>();
+	edarcs1 = edarcs2 = edarcs3 = edarcs4 = EDArenaArray<MyArc>();
+	bm = BufferManager();
+	segmentStartLines = NULL;
+	info = NULL;
+	if (arena == &ownArena) arena->release(); else arena->reset();
+	arena = NULL;
 }
 
 Mat EDCircles::drawResult(bool onImage, ImageStyle style)
@@ -774,15 +331,15 @@ int EDCircles::getEllipsesNo()
 void EDCircles::GenerateCandidateCircles()
 {
 	// Now, go over the circular arcs & add them to circles1
-	MyArc* arcs = edarcs4->arcs;
-	for (int i = 0; i < edarcs4->noArcs; i++)
+	MyArc* arcs = edarcs4.items;
+	for (int i = 0; i < edarcs4.size; i++)
 	{
 		if (arcs[i].isEllipse)
 		{
 			// Ellipse
 			if (arcs[i].coverRatio >= CANDIDATE_ELLIPSE_RATIO && arcs[i].ellipseFitError <= ELLIPSE_ERROR)
 			{
-				addCircle(circles1, noCircles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError, &arcs[i].eq,
+				addCircle(circles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError, &arcs[i].eq,
 				          arcs[i].ellipseFitError,
 				          arcs[i].x, arcs[i].y, arcs[i].noPixels);
 			}
@@ -794,7 +351,7 @@ void EDCircles::GenerateCandidateCircles()
 					(coverRatio >= HALF_CIRCLE_RATIO && arcs[i].circleFitError <= HALF_ARC_ERROR) ||
 					(coverRatio >= CANDIDATE_CIRCLE_RATIO2 && arcs[i].circleFitError <= SHORT_ARC_ERROR))
 				{
-					addCircle(circles1, noCircles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError,
+					addCircle(circles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError,
 					          arcs[i].x, arcs[i].y, arcs[i].noPixels);
 				} //end-if
 			} //end-else
@@ -809,7 +366,7 @@ void EDCircles::GenerateCandidateCircles()
 				(arcs[i].coverRatio >= HALF_CIRCLE_RATIO && arcs[i].circleFitError <= HALF_ARC_ERROR) ||
 				(arcs[i].coverRatio >= CANDIDATE_CIRCLE_RATIO2 && arcs[i].circleFitError <= SHORT_ARC_ERROR))
 			{
-				addCircle(circles1, noCircles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError, arcs[i].x,
+				addCircle(circles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError, arcs[i].x,
 				          arcs[i].y, arcs[i].noPixels);
 
 				continue;
@@ -833,7 +390,7 @@ void EDCircles::GenerateCandidateCircles()
 
 			if (coverRatio >= CANDIDATE_ELLIPSE_RATIO && ellipseFitError <= ELLIPSE_ERROR)
 			{
-				addCircle(circles1, noCircles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError, &eq,
+				addCircle(circles1, arcs[i].xc, arcs[i].yc, arcs[i].r, arcs[i].circleFitError, &eq,
 				          ellipseFitError, arcs[i].x, arcs[i].y, arcs[i].noPixels);
 			} //end-if
 		} //end-else
@@ -860,6 +417,12 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 			// We need at least 2 line segments
 			if (stopLine - firstLine <= 1) continue;
 
+			// The arcs of a segment take its lines' pixels, each line at most twice plus one wrapped line at either
+			// end. Reserved at once, the arcs of a segment follow each other in the buffer (see joinLastTwoArcs).
+			int segmentPixels = lines[firstLine].len + lines[stopLine - 1].len;
+			for (int j = firstLine; j < stopLine; j++) segmentPixels += 2 * lines[j].len;
+			bm.reserve(segmentPixels);
+
 			// Process the info for the lines of this segment
 			while (firstLine < stopLine - 1)
 			{
@@ -958,8 +521,8 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 
 				// Copy the pixels of this segment to an array
 				int noPixels = 0;
-				double* x = bm->getX();
-				double* y = bm->getY();
+				float* x = bm.getX();
+				float* y = bm.getY();
 
 				// wrapCase 1: Combine the first two lines with the last line of the segment
 				if (wrapCase == 1)
@@ -1000,7 +563,7 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 				} //end-if
 
 				// Move buffer pointers
-				bm->move(noPixels);
+				bm.move(noPixels);
 
 				// Try to fit a circle to the entire arc of lines
 				double xc, yc, radius, circleFitError;
@@ -1035,14 +598,14 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 
 					if ((coverage >= FULL_CIRCLE_RATIO && circleFitError <= LONG_ARC_ERROR))
 					{
-						addCircle(circles1, noCircles1, xc, yc, radius, circleFitError, x, y, noPixels);
+						addCircle(circles1, xc, yc, radius, circleFitError, x, y, noPixels);
 					}
 					else
 					{
 						double sTheta, eTheta;
 						ComputeStartAndEndAngles(xc, yc, radius, x, y, noPixels, &sTheta, &eTheta);
 
-						addArc(edarcs1->arcs, edarcs1->noArcs, xc, yc, radius, circleFitError, sTheta, eTheta,
+						addArc(edarcs1, xc, yc, radius, circleFitError, sTheta, eTheta,
 						       info[firstLine].sign, curSegmentNo,
 						       static_cast<int>(x[0]), static_cast<int>(y[0]), static_cast<int>(x[noPixels - 1]),
 						       static_cast<int>(y[noPixels - 1]), x, y, noPixels);
@@ -1087,7 +650,7 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 
 						if (isAlmostClosedLoop)
 						{
-							addCircle(circles1, noCircles1, xc, yc, radius, circleFitError, &eq, ellipseFitError, x, y,
+							addCircle(circles1, xc, yc, radius, circleFitError, &eq, ellipseFitError, x, y,
 							          noPixels); // Add an ellipse for validation
 						}
 						else
@@ -1095,7 +658,7 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 							double sTheta, eTheta;
 							ComputeStartAndEndAngles(xc, yc, radius, x, y, noPixels, &sTheta, &eTheta);
 
-							addArc(edarcs1->arcs, edarcs1->noArcs, xc, yc, radius, circleFitError, sTheta, eTheta,
+							addArc(edarcs1, xc, yc, radius, circleFitError, sTheta, eTheta,
 							       info[firstLine].sign, curSegmentNo, &eq, ellipseFitError,
 							       static_cast<int>(x[0]), static_cast<int>(y[0]), static_cast<int>(x[noPixels - 1]),
 							       static_cast<int>(y[noPixels - 1]), x, y, noPixels);
@@ -1180,7 +743,7 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 					double coverage = noPixels / (TWOPI * radius);
 					if ((coverage >= FULL_CIRCLE_RATIO && circleFitError <= LONG_ARC_ERROR))
 					{
-						addCircle(circles1, noCircles1, XC, YC, R, Error, x, y, noPixels);
+						addCircle(circles1, XC, YC, R, Error, x, y, noPixels);
 					}
 					else
 					{
@@ -1188,7 +751,7 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 						double sTheta, eTheta;
 						ComputeStartAndEndAngles(XC, YC, R, x, y, noPixels, &sTheta, &eTheta);
 
-						addArc(edarcs1->arcs, edarcs1->noArcs, XC, YC, R, Error, sTheta, eTheta, info[firstLine].sign,
+						addArc(edarcs1, XC, YC, R, Error, sTheta, eTheta, info[firstLine].sign,
 						       curSegmentNo,
 						       static_cast<int>(x[0]), static_cast<int>(y[0]), static_cast<int>(x[noPixels - 1]),
 						       static_cast<int>(y[noPixels - 1]), x, y, noPixels);
@@ -1213,23 +776,54 @@ void EDCircles::DetectArcs(vector<LineSegment> lines)
 //
 void EDCircles::ValidateCircles()
 {
-	double prec = PI / 16; // Alignment precision
 	double prob = 1.0 / 8; // probability of alignment
 
-	int points_buffer_size = 8 * (width + height);
-	auto px = new double[points_buffer_size];
-	auto py = new double[points_buffer_size];
-
 	// logNT & LUT for NFA computation
 	double logNT = 2 * log10(static_cast<double>(width * height)) + log10(static_cast<double>(width + height));
 
 	int lutSize = (width + height) / 8;
-	nfa = new NFALUT(lutSize, prob, logNT); // create look up table
+	nfa = NFALUT::get(lutSize, prob, logNT); // shared look up table
+
+	// Candidates are independent: validate them in parallel, each task with its own point buffers
+	EDWorkspace localWorkspace; // used only if no workspace is attached
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
+
+	int noCandidates = circles1.size;
+	vector<char> valid(noCandidates, 0);
+	int noTasks = threadPool ? MIN(threadPool->get_workers_num(), noCandidates / 16) : 1;
+
+	if (noTasks <= 1)
+		ValidateCircles(0, noCandidates, ws, valid.data());
+	else {
+		EDWorkspace *taskWorkspaces = ws->getTileWorkspaces(noTasks);
+		vector<std::future<void>> results;
+		for (int t = 0; t < noTasks; t++)
+			results.push_back(threadPool->enqueue([this, &valid, taskWorkspaces, noCandidates, noTasks, t] {
+				ValidateCircles(noCandidates*t / noTasks, noCandidates*(t + 1) / noTasks, &taskWorkspaces[t], valid.data());
+			}));
+		WaitForTasks(results);
+	} //end-else
+
+	// Accepted circles in candidate order
+	for (int i = 0; i < noCandidates; i++)
+		if (valid[i]) circles2.add() = circles1[i];
+}
+
+//-----------------------------------------------------------------
+// Sets valid[i] for circles1[first ... last-1]. A circle that fails but is better fit by an ellipse is turned into
+// that ellipse (in place) and validated again.
+//
+void EDCircles::ValidateCircles(int first, int last, EDWorkspace *ws, char *valid)
+{
+	double prec = PI / 16; // Alignment precision
+
+	int points_buffer_size = 8 * (width + height);
+	double *px = ws->getPointX(points_buffer_size);
+	double *py = ws->getPointY(points_buffer_size);
 
 	// Validate circles & ellipses
 	bool validateAgain;
-	int count = 0;
-	for (int i = 0; i < noCircles1;)
+	for (int i = first; i < last;)
 	{
 		Circle* circle = &circles1[i];
 		double xc = circle->xc;
@@ -1435,7 +1029,7 @@ void EDCircles::ValidateCircles()
 
 		if (isValid)
 		{
-			circles2[count++] = circles1[i];
+			valid[i] = 1;
 		}
 		else if (circle->isEllipse == false && circle->coverRatio >= CANDIDATE_ELLIPSE_RATIO)
 		{
@@ -1460,21 +1054,15 @@ void EDCircles::ValidateCircles()
 
 		if (validateAgain == false) i++;
 	} //end-for
-
-	noCircles2 = count;
-
-	delete[] px;
-	delete[] py;
-	delete nfa;
 }
 
 void EDCircles::JoinCircles()
 {
 	// Sort the circles wrt their radius
-	sortCircle(circles2, noCircles2);
+	sortCircle(circles2.items, circles2.size);
 
-	int noCircles = noCircles2;
-	Circle* circles = circles2;
+	int noCircles = circles2.size;
+	Circle* circles = circles2.items;
 
 	for (int i = 0; i < noCircles; i++)
 	{
@@ -1485,10 +1073,10 @@ void EDCircles::JoinCircles()
 		} //end-if
 	} //end-for
 
-	auto taken = new bool[noCircles];
+	bool* taken = arena->allocate<bool>(noCircles);
 	for (int i = 0; i < noCircles; i++) taken[i] = false;
 
-	auto candidateCircles = new int[noCircles];
+	int* candidateCircles = arena->allocate<int>(noCircles);
 	int noCandidateCircles;
 
 	for (int i = 0; i < noCircles; i++)
@@ -1560,18 +1148,22 @@ void EDCircles::JoinCircles()
 		if (noCandidateCircles > 0)
 		{
 			int noPixels = circles[i].noPixels;
-			double* x = bm->getX();
-			double* y = bm->getY();
-			memcpy(x, circles[i].x, noPixels * sizeof(double));
-			memcpy(y, circles[i].y, noPixels * sizeof(double));
+			int joinedPixels = noPixels;
+			for (int j = 0; j < noCandidateCircles; j++) joinedPixels += circles[candidateCircles[j]].noPixels;
+			bm.reserve(joinedPixels);
+
+			float* x = bm.getX();
+			float* y = bm.getY();
+			memcpy(x, circles[i].x, noPixels * sizeof(float));
+			memcpy(y, circles[i].y, noPixels * sizeof(float));
 
 			for (int j = 0; j < noCandidateCircles; j++)
 			{
 				int CandidateArcNo = candidateCircles[j];
 
 				int noPixelsSave = noPixels;
-				memcpy(x + noPixels, circles[CandidateArcNo].x, circles[CandidateArcNo].noPixels * sizeof(double));
-				memcpy(y + noPixels, circles[CandidateArcNo].y, circles[CandidateArcNo].noPixels * sizeof(double));
+				memcpy(x + noPixels, circles[CandidateArcNo].x, circles[CandidateArcNo].noPixels * sizeof(float));
+				memcpy(y + noPixels, circles[CandidateArcNo].y, circles[CandidateArcNo].noPixels * sizeof(float));
 				noPixels += circles[CandidateArcNo].noPixels;
 
 				bool circleFitOK = false;
@@ -1629,21 +1221,18 @@ void EDCircles::JoinCircles()
 		// Add the new circle/ellipse to circles2
 		if (CircleFitValid)
 		{
-			addCircle(circles3, noCircles3, XC, YC, R, CircleFitError, nullptr, nullptr, 0);
+			addCircle(circles3, XC, YC, R, CircleFitError, nullptr, nullptr, 0);
 		}
 		else if (EllipseFitValid)
 		{
-			addCircle(circles3, noCircles3, XC, YC, R, CircleFitError, &Eq, EllipseFitError, nullptr, nullptr, 0);
+			addCircle(circles3, XC, YC, R, CircleFitError, &Eq, EllipseFitError, nullptr, nullptr, 0);
 		}
 		else
 		{
-			circles3[noCircles3] = circles[i];
-			noCircles3++;
+			circles3.add() = circles[i];
 		} //end-else
 	} //end-for
 
-	delete[] taken;
-	delete[] candidateCircles;
 }
 
 void EDCircles::JoinArcs1()
@@ -1651,12 +1240,16 @@ void EDCircles::JoinArcs1()
 	AngleSet angles;
 
 	// Sort the arcs with respect to their length so that longer arcs are at the beginning
-	sortArc(edarcs1->arcs, edarcs1->noArcs);
+	sortArc(edarcs1.items, edarcs1.size);
+
+	int noArcs = edarcs1.size;
+	MyArc* arcs = edarcs1.items;
 
-	int noArcs = edarcs1->noArcs;
-	MyArc* arcs = edarcs1->arcs;
+	// An arc & the arcs joined to it take at most all pixels of the arcs
+	int totalPixels = 0;
+	for (int i = 0; i < noArcs; i++) totalPixels += arcs[i].noPixels;
 
-	auto taken = new bool[noArcs];
+	bool* taken = arena->allocate<bool>(noArcs);
 	for (int i = 0; i < noArcs; i++) taken[i] = false;
 
 	struct CandidateArc
@@ -1666,7 +1259,7 @@ void EDCircles::JoinArcs1()
 		double dist; // min distance between the end points
 	};
 
-	auto candidateArcs = new CandidateArc[noArcs];
+	CandidateArc* candidateArcs = arena->allocate<CandidateArc>(noArcs);
 	int noCandidateArcs;
 
 	for (int i = 0; i < noArcs; i++)
@@ -1674,7 +1267,7 @@ void EDCircles::JoinArcs1()
 		if (taken[i]) continue;
 		if (arcs[i].isEllipse)
 		{
-			edarcs2->arcs[edarcs2->noArcs++] = arcs[i];
+			edarcs2.add() = arcs[i];
 			continue;
 		}
 
@@ -1695,10 +1288,11 @@ void EDCircles::JoinArcs1()
 		// Take the pixels making up this arc
 		int noPixels = arcs[i].noPixels;
 
-		double* x = bm->getX();
-		double* y = bm->getY();
-		memcpy(x, arcs[i].x, noPixels * sizeof(double));
-		memcpy(y, arcs[i].y, noPixels * sizeof(double));
+		bm.reserve(totalPixels);
+		float* x = bm.getX();
+		float* y = bm.getY();
+		memcpy(x, arcs[i].x, noPixels * sizeof(float));
+		memcpy(y, arcs[i].y, noPixels * sizeof(float));
 
 		angles.clear();
 		angles.set(arcs[i].sTheta, arcs[i].eTheta);
@@ -1806,8 +1400,8 @@ void EDCircles::JoinArcs1()
 					int Which = candidateArcs[j].which;
 
 					int noPixelsSave = noPixels;
-					memcpy(x + noPixels, arcs[CandidateArcNo].x, arcs[CandidateArcNo].noPixels * sizeof(double));
-					memcpy(y + noPixels, arcs[CandidateArcNo].y, arcs[CandidateArcNo].noPixels * sizeof(double));
+					memcpy(x + noPixels, arcs[CandidateArcNo].x, arcs[CandidateArcNo].noPixels * sizeof(float));
+					memcpy(y + noPixels, arcs[CandidateArcNo].y, arcs[CandidateArcNo].noPixels * sizeof(float));
 					noPixels += arcs[CandidateArcNo].noPixels;
 
 					double xc, yc, r, circleFitError;
@@ -1875,7 +1469,7 @@ void EDCircles::JoinArcs1()
 		if (CircleEqValid == false)
 		{
 			// Add to arcs
-			edarcs2->arcs[edarcs2->noArcs++] = arcs[i];
+			edarcs2.add() = arcs[i];
 		}
 		else
 		{
@@ -1885,17 +1479,15 @@ void EDCircles::JoinArcs1()
 
 			double coverage = ArcLength(sTheta, eTheta) / TWOPI;
 			if ((coverage >= FULL_CIRCLE_RATIO && CircleFitError <= LONG_ARC_ERROR))
-				addCircle(circles1, noCircles1, XC, YC, R, CircleFitError, x, y, NoPixels);
+				addCircle(circles1, XC, YC, R, CircleFitError, x, y, NoPixels);
 			else
-				addArc(edarcs2->arcs, edarcs2->noArcs, XC, YC, R, CircleFitError, sTheta, eTheta, Turn,
+				addArc(edarcs2, XC, YC, R, CircleFitError, sTheta, eTheta, Turn,
 				       arcs[i].segmentNo, SX, SY, EX, EY, x, y, NoPixels, angles.overlapRatio());
 
-			bm->move(NoPixels);
+			bm.move(NoPixels);
 		} //end-if
 	} //end-for
 
-	delete[] taken;
-	delete[] candidateArcs;
 }
 
 void EDCircles::JoinArcs2()
@@ -1903,12 +1495,16 @@ void EDCircles::JoinArcs2()
 	AngleSet angles;
 
 	// Sort the arcs with respect to their length so that longer arcs are at the beginning
-	sortArc(edarcs2->arcs, edarcs2->noArcs);
+	sortArc(edarcs2.items, edarcs2.size);
 
-	int noArcs = edarcs2->noArcs;
-	MyArc* arcs = edarcs2->arcs;
+	int noArcs = edarcs2.size;
+	MyArc* arcs = edarcs2.items;
 
-	auto taken = new bool[noArcs];
+	// An arc & the arcs joined to it take at most all pixels of the arcs
+	int totalPixels = 0;
+	for (int i = 0; i < noArcs; i++) totalPixels += arcs[i].noPixels;
+
+	bool* taken = arena->allocate<bool>(noArcs);
 	for (int i = 0; i < noArcs; i++) taken[i] = false;
 
 	struct CandidateArc
@@ -1918,7 +1514,7 @@ void EDCircles::JoinArcs2()
 		double dist; // min distance between the end points
 	};
 
-	auto candidateArcs = new CandidateArc[noArcs];
+	CandidateArc* candidateArcs = arena->allocate<CandidateArc>(noArcs);
 	int noCandidateArcs;
 
 	for (int i = 0; i < noArcs; i++)
@@ -1942,10 +1538,11 @@ void EDCircles::JoinArcs2()
 		// Take the pixels making up this arc
 		int noPixels = arcs[i].noPixels;
 
-		double* x = bm->getX();
-		double* y = bm->getY();
-		memcpy(x, arcs[i].x, noPixels * sizeof(double));
-		memcpy(y, arcs[i].y, noPixels * sizeof(double));
+		bm.reserve(totalPixels);
+		float* x = bm.getX();
+		float* y = bm.getY();
+		memcpy(x, arcs[i].x, noPixels * sizeof(float));
+		memcpy(y, arcs[i].y, noPixels * sizeof(float));
 
 		angles.clear();
 		angles.set(arcs[i].sTheta, arcs[i].eTheta);
@@ -2040,8 +1637,8 @@ void EDCircles::JoinArcs2()
 					int Which = candidateArcs[j].which;
 
 					int noPixelsSave = noPixels;
-					memcpy(x + noPixels, arcs[CandidateArcNo].x, arcs[CandidateArcNo].noPixels * sizeof(double));
-					memcpy(y + noPixels, arcs[CandidateArcNo].y, arcs[CandidateArcNo].noPixels * sizeof(double));
+					memcpy(x + noPixels, arcs[CandidateArcNo].x, arcs[CandidateArcNo].noPixels * sizeof(float));
+					memcpy(y + noPixels, arcs[CandidateArcNo].y, arcs[CandidateArcNo].noPixels * sizeof(float));
 					noPixels += arcs[CandidateArcNo].noPixels;
 
 					// Directly fit an ellipse
@@ -2111,7 +1708,7 @@ void EDCircles::JoinArcs2()
 		if (EllipseEqValid == false)
 		{
 			// Add to arcs
-			edarcs3->arcs[edarcs3->noArcs++] = arcs[i];
+			edarcs3.add() = arcs[i];
 		}
 		else
 		{
@@ -2124,18 +1721,16 @@ void EDCircles::JoinArcs2()
 
 			double coverage = ArcLength(sTheta, eTheta) / TWOPI;
 			if ((coverage >= FULL_CIRCLE_RATIO && CircleFitError <= LONG_ARC_ERROR))
-				addCircle(circles1, noCircles1, XC, YC, R, CircleFitError, x, y, NoPixels);
+				addCircle(circles1, XC, YC, R, CircleFitError, x, y, NoPixels);
 			else
-				addArc(edarcs3->arcs, edarcs3->noArcs, XC, YC, R, CircleFitError, sTheta, eTheta, Turn,
+				addArc(edarcs3, XC, YC, R, CircleFitError, sTheta, eTheta, Turn,
 				       arcs[i].segmentNo, &Eq, EllipseFitError, SX, SY, EX, EY, x, y, NoPixels, angles.overlapRatio());
 
 			// Move buffer pointers
-			bm->move(NoPixels);
+			bm.move(NoPixels);
 		} //end-if
 	} //end-for
 
-	delete[] taken;
-	delete[] candidateArcs;
 }
 
 void EDCircles::JoinArcs3()
@@ -2143,12 +1738,16 @@ void EDCircles::JoinArcs3()
 	AngleSet angles;
 
 	// Sort the arcs with respect to their length so that longer arcs are at the beginning
-	sortArc(edarcs3->arcs, edarcs3->noArcs);
+	sortArc(edarcs3.items, edarcs3.size);
+
+	int noArcs = edarcs3.size;
+	MyArc* arcs = edarcs3.items;
 
-	int noArcs = edarcs3->noArcs;
-	MyArc* arcs = edarcs3->arcs;
+	// An arc & the arcs joined to it take at most all pixels of the arcs
+	int totalPixels = 0;
+	for (int i = 0; i < noArcs; i++) totalPixels += arcs[i].noPixels;
 
-	auto taken = new bool[noArcs];
+	bool* taken = arena->allocate<bool>(noArcs);
 	for (int i = 0; i < noArcs; i++) taken[i] = false;
 
 	struct CandidateArc
@@ -2158,7 +1757,7 @@ void EDCircles::JoinArcs3()
 		double dist; // min distance between the end points
 	};
 
-	auto candidateArcs = new CandidateArc[noArcs];
+	CandidateArc* candidateArcs = arena->allocate<CandidateArc>(noArcs);
 	int noCandidateArcs;
 
 	for (int i = 0; i < noArcs; i++)
@@ -2182,10 +1781,11 @@ void EDCircles::JoinArcs3()
 		// Take the pixels making up this arc
 		int noPixels = arcs[i].noPixels;
 
-		double* x = bm->getX();
-		double* y = bm->getY();
-		memcpy(x, arcs[i].x, noPixels * sizeof(double));
-		memcpy(y, arcs[i].y, noPixels * sizeof(double));
+		bm.reserve(totalPixels);
+		float* x = bm.getX();
+		float* y = bm.getY();
+		memcpy(x, arcs[i].x, noPixels * sizeof(float));
+		memcpy(y, arcs[i].y, noPixels * sizeof(float));
 
 		angles.clear();
 		angles.set(arcs[i].sTheta, arcs[i].eTheta);
@@ -2298,8 +1898,8 @@ void EDCircles::JoinArcs3()
 					int Which = candidateArcs[j].which;
 
 					int noPixelsSave = noPixels;
-					memcpy(x + noPixels, arcs[CandidateArcNo].x, arcs[CandidateArcNo].noPixels * sizeof(double));
-					memcpy(y + noPixels, arcs[CandidateArcNo].y, arcs[CandidateArcNo].noPixels * sizeof(double));
+					memcpy(x + noPixels, arcs[CandidateArcNo].x, arcs[CandidateArcNo].noPixels * sizeof(float));
+					memcpy(y + noPixels, arcs[CandidateArcNo].y, arcs[CandidateArcNo].noPixels * sizeof(float));
 					noPixels += arcs[CandidateArcNo].noPixels;
 
 					// Directly fit an ellipse
@@ -2369,7 +1969,7 @@ void EDCircles::JoinArcs3()
 		if (EllipseEqValid == false)
 		{
 			// Add to arcs
-			edarcs4->arcs[edarcs4->noArcs++] = arcs[i];
+			edarcs4.add() = arcs[i];
 		}
 		else
 		{
@@ -2382,59 +1982,55 @@ void EDCircles::JoinArcs3()
 
 			double coverage = ArcLength(sTheta, eTheta) / TWOPI;
 			if ((coverage >= FULL_CIRCLE_RATIO && CircleFitError <= LONG_ARC_ERROR))
-				addCircle(circles1, noCircles1, XC, YC, R, CircleFitError, x, y, NoPixels);
+				addCircle(circles1, XC, YC, R, CircleFitError, x, y, NoPixels);
 			else
-				addArc(edarcs4->arcs, edarcs4->noArcs, XC, YC, R, CircleFitError, sTheta, eTheta, Turn,
+				addArc(edarcs4, XC, YC, R, CircleFitError, sTheta, eTheta, Turn,
 				       arcs[i].segmentNo, &Eq, EllipseFitError, SX, SY, EX, EY, x, y, NoPixels, angles.overlapRatio());
 
-			bm->move(NoPixels);
+			bm.move(NoPixels);
 		} //end-if
 	} //end-for
 
-	delete[] taken;
-	delete[] candidateArcs;
 }
 
-Circle* EDCircles::addCircle(Circle* circles, int& noCircles, double xc, double yc, double r, double circleFitError,
-                             double* x, double* y, int noPixels)
+Circle* EDCircles::addCircle(EDArenaArray<Circle>& circles, double xc, double yc, double r, double circleFitError,
+                             float* x, float* y, int noPixels)
 {
-	circles[noCircles].xc = xc;
-	circles[noCircles].yc = yc;
-	circles[noCircles].r = r;
-	circles[noCircles].circleFitError = circleFitError;
-	circles[noCircles].coverRatio = noPixels / (TWOPI * r);
-
-	circles[noCircles].x = x;
-	circles[noCircles].y = y;
-	circles[noCircles].noPixels = noPixels;
+	Circle& circle = circles.add();
+	circle.xc = xc;
+	circle.yc = yc;
+	circle.r = r;
+	circle.circleFitError = circleFitError;
+	circle.coverRatio = noPixels / (TWOPI * r);
 
-	circles[noCircles].isEllipse = false;
+	circle.x = x;
+	circle.y = y;
+	circle.noPixels = noPixels;
 
-	noCircles++;
+	circle.isEllipse = false;
 
-	return &circles[noCircles - 1];
+	return &circle;
 }
 
-Circle* EDCircles::addCircle(Circle* circles, int& noCircles, double xc, double yc, double r, double circleFitError,
-                             EllipseEquation* pEq, double ellipseFitError, double* x, double* y, int noPixels)
+Circle* EDCircles::addCircle(EDArenaArray<Circle>& circles, double xc, double yc, double r, double circleFitError,
+                             EllipseEquation* pEq, double ellipseFitError, float* x, float* y, int noPixels)
 {
-	circles[noCircles].xc = xc;
-	circles[noCircles].yc = yc;
-	circles[noCircles].r = r;
-	circles[noCircles].circleFitError = circleFitError;
-	circles[noCircles].coverRatio = noPixels / computeEllipsePerimeter(pEq);
-
-	circles[noCircles].x = x;
-	circles[noCircles].y = y;
-	circles[noCircles].noPixels = noPixels;
-
-	circles[noCircles].eq = *pEq;
-	circles[noCircles].ellipseFitError = ellipseFitError;
-	circles[noCircles].isEllipse = true;
-
-	noCircles++;
-
-	return &circles[noCircles - 1];
+	Circle& circle = circles.add();
+	circle.xc = xc;
+	circle.yc = yc;
+	circle.r = r;
+	circle.circleFitError = circleFitError;
+	circle.coverRatio = noPixels / computeEllipsePerimeter(pEq);
+
+	circle.x = x;
+	circle.y = y;
+	circle.noPixels = noPixels;
+
+	circle.eq = *pEq;
+	circle.ellipseFitError = ellipseFitError;
+	circle.isEllipse = true;
+
+	return &circle;
 }
 
 void EDCircles::sortCircles(Circle* circles, int noCircles)
@@ -2563,7 +2159,7 @@ double EDCircles::computeEllipsePerimeter(EllipseEquation* eq)
 #undef pi
 }
 
-double EDCircles::ComputeEllipseError(EllipseEquation* eq, double* px, double* py, int noPoints)
+double EDCircles::ComputeEllipseError(EllipseEquation* eq, float* px, float* py, int noPoints)
 {
 	double error = 0;
 
@@ -2979,6 +2575,9 @@ void EDCircles::joinLastTwoArcs(MyArc* arcs, int& noArcs)
 	if (arcs[prev].turn != arcs[last].turn) return;
 	if (arcs[prev].isEllipse || arcs[last].isEllipse) return;
 
+	// The fit below runs over the pixels of both arcs, which must follow each other in the buffer
+	if (arcs[prev].x + arcs[prev].noPixels != arcs[last].x) return;
+
 	// The radius difference between the arcs must be very small
 	double minR = MIN(arcs[prev].r, arcs[last].r);
 	double radiusDiffThreshold = minR * 0.25;
@@ -3028,82 +2627,80 @@ void EDCircles::joinLastTwoArcs(MyArc* arcs, int& noArcs)
 //-----------------------------------------------------------------------
 // Add a new arc to arcs
 //
-void EDCircles::addArc(MyArc* arcs, int& noArcs, double xc, double yc, double r, double circleFitError, double sTheta,
-                       double eTheta, int turn, int segmentNo, int sx, int sy, int ex, int ey, double* x, double* y,
+void EDCircles::addArc(EDArenaArray<MyArc>& arcs, double xc, double yc, double r, double circleFitError, double sTheta,
+                       double eTheta, int turn, int segmentNo, int sx, int sy, int ex, int ey, float* x, float* y,
                        int noPixels, double overlapRatio)
 {
-	arcs[noArcs].xc = xc;
-	arcs[noArcs].yc = yc;
-	arcs[noArcs].r = r;
-	arcs[noArcs].circleFitError = circleFitError;
-
-	arcs[noArcs].sTheta = sTheta;
-	arcs[noArcs].eTheta = eTheta;
-	arcs[noArcs].coverRatio = ArcLength(sTheta, eTheta) / (TWOPI);
+	MyArc& arc = arcs.add();
+	arc.xc = xc;
+	arc.yc = yc;
+	arc.r = r;
+	arc.circleFitError = circleFitError;
 
-	arcs[noArcs].turn = turn;
+	arc.sTheta = sTheta;
+	arc.eTheta = eTheta;
+	arc.coverRatio = ArcLength(sTheta, eTheta) / (TWOPI);
 
-	arcs[noArcs].segmentNo = segmentNo;
+	arc.turn = turn;
 
-	arcs[noArcs].isEllipse = false;
+	arc.segmentNo = segmentNo;
 
-	arcs[noArcs].sx = sx;
-	arcs[noArcs].sy = sy;
-	arcs[noArcs].ex = ex;
-	arcs[noArcs].ey = ey;
+	arc.isEllipse = false;
 
-	arcs[noArcs].x = x;
-	arcs[noArcs].y = y;
-	arcs[noArcs].noPixels = noPixels;
+	arc.sx = sx;
+	arc.sy = sy;
+	arc.ex = ex;
+	arc.ey = ey;
 
-	noArcs++;
+	arc.x = x;
+	arc.y = y;
+	arc.noPixels = noPixels;
 
 	// See if you can join the last two arcs
-	joinLastTwoArcs(arcs, noArcs);
+	joinLastTwoArcs(arcs.items, arcs.size);
 }
 
 //-------------------------------------------------------------------------
 // Add an elliptic arc to the list of arcs
 //
-void EDCircles::addArc(MyArc* arcs, int& noArcs, double xc, double yc, double r, double circleFitError, double sTheta,
+void EDCircles::addArc(EDArenaArray<MyArc>& arcs, double xc, double yc, double r, double circleFitError, double sTheta,
                        double eTheta, int turn, int segmentNo, EllipseEquation* pEq, double ellipseFitError, int sx,
-                       int sy, int ex, int ey, double* x, double* y, int noPixels, double overlapRatio)
+                       int sy, int ex, int ey, float* x, float* y, int noPixels, double overlapRatio)
 {
-	arcs[noArcs].xc = xc;
-	arcs[noArcs].yc = yc;
-	arcs[noArcs].r = r;
-	arcs[noArcs].circleFitError = circleFitError;
-
-	arcs[noArcs].sTheta = sTheta;
-	arcs[noArcs].eTheta = eTheta;
-	arcs[noArcs].coverRatio = (1.0 - overlapRatio) * noPixels / computeEllipsePerimeter(pEq);
-	//  arcs[noArcs].coverRatio = noPixels/ComputeEllipsePerimeter(pEq);
-	//  arcs[noArcs].coverRatio = ArcLength(sTheta, eTheta)/(TWOPI);
-
-	arcs[noArcs].turn = turn;
-
-	arcs[noArcs].segmentNo = segmentNo;
-
-	arcs[noArcs].isEllipse = true;
-	arcs[noArcs].eq = *pEq;
-	arcs[noArcs].ellipseFitError = ellipseFitError;
-
-	arcs[noArcs].sx = sx;
-	arcs[noArcs].sy = sy;
-	arcs[noArcs].ex = ex;
-	arcs[noArcs].ey = ey;
-
-	arcs[noArcs].x = x;
-	arcs[noArcs].y = y;
-	arcs[noArcs].noPixels = noPixels;
-
-	noArcs++;
+	MyArc& arc = arcs.add();
+	arc.xc = xc;
+	arc.yc = yc;
+	arc.r = r;
+	arc.circleFitError = circleFitError;
+
+	arc.sTheta = sTheta;
+	arc.eTheta = eTheta;
+	arc.coverRatio = (1.0 - overlapRatio) * noPixels / computeEllipsePerimeter(pEq);
+	//  arc.coverRatio = noPixels/ComputeEllipsePerimeter(pEq);
+	//  arc.coverRatio = ArcLength(sTheta, eTheta)/(TWOPI);
+
+	arc.turn = turn;
+
+	arc.segmentNo = segmentNo;
+
+	arc.isEllipse = true;
+	arc.eq = *pEq;
+	arc.ellipseFitError = ellipseFitError;
+
+	arc.sx = sx;
+	arc.sy = sy;
+	arc.ex = ex;
+	arc.ey = ey;
+
+	arc.x = x;
+	arc.y = y;
+	arc.noPixels = noPixels;
 }
 
 //--------------------------------------------------------------
 // Given a circular arc, computes the start & end angles of the arc in radians
 //
-void EDCircles::ComputeStartAndEndAngles(double xc, double yc, double r, double* x, double* y, int len, double* psTheta,
+void EDCircles::ComputeStartAndEndAngles(double xc, double yc, double r, float* x, float* y, int len, double* psTheta,
                                          double* peTheta)
 {
 	double sx = x[0];
@@ -3289,7 +2886,7 @@ void EDCircles::sortArc(MyArc* arcs, int noArcs)
 // The circle equation is of the form: (x-xc)^2 + (y-yc)^2 = r^2
 // Returns true if there is a fit, false in case no circles can be fit
 //
-bool EDCircles::CircleFit(double* x, double* y, int N, double* pxc, double* pyc, double* pr, double* pe)
+bool EDCircles::CircleFit(float* x, float* y, int N, double* pxc, double* pyc, double* pr, double* pe)
 {
 	*pe = 1e20;
 	if (N < 3) return false;
@@ -3413,7 +3010,7 @@ void EDCircles::sortCircle(Circle* circles, int noCircles)
 	} //end-for
 }
 
-bool EDCircles::EllipseFit(double* x, double* y, int noPoints, EllipseEquation* pResult, int mode)
+bool EDCircles::EllipseFit(float* x, float* y, int noPoints, EllipseEquation* pResult, int mode)
 {
 	double** D = AllocateMatrix(noPoints + 1, 7);
 	double** S = AllocateMatrix(7, 7);
@@ -79,7 +79,7 @@ struct Circle {
 	double circleFitError;   // circle fit error
 	double coverRatio;       // Percentage of the circle covered by the arcs making up this circle [0-1]
 
-	double *x, *y;           // Pointers to buffers containing the pixels making up this circle
+	float *x, *y;            // Pointers to buffers containing the pixels making up this circle
 	int noPixels;            // # of pixels making up this circle
 
 							 // If this circle is better approximated by an ellipse, we set isEllipse to true & eq contains the ellipse's equation
@@ -105,7 +105,7 @@ struct MyArc {
 	int sx, sy;                 // Start (x, y) coordinate
 	int ex, ey;                 // End (x, y) coordinate of the arc
 
-	double *x, *y;              // Pointer to buffer containing the pixels making up this arc
+	float *x, *y;               // Pointer to buffer containing the pixels making up this arc
 	int noPixels;               // # of pixels making up the arc    
 
 	bool isEllipse;             // Did we fit an ellipse to this arc? 
@@ -151,41 +151,35 @@ struct AngleSet {
 };
 
 
-struct EDArcs {
-	MyArc *arcs;
-	int noArcs;
-
-public:
-	EDArcs(int size = 10000) {
-		arcs = new MyArc[size];
-		noArcs = 0;
-	} //end-EDArcs
-
-	~EDArcs() {
-		delete[] arcs;
-	} //end-~EDArcs
-};
-
-
 //-----------------------------------------------------------------
-// Buffer manager
+// Buffer manager: pixel coordinates of arcs & circles, stored one after the other in arrays from an EDArena.
+// Pixel coordinates are integers, so float holds them exactly.
 struct BufferManager {
-	double *x, *y;
+	float *x, *y;
 	int index;
-
-	BufferManager(int maxSize) {
-		x = new double[maxSize];
-		y = new double[maxSize];
+	int capacity;
+	EDArena *arena;
+
+	BufferManager() : x(NULL), y(NULL), index(0), capacity(0), arena(NULL) {}
+
+	void init(EDArena *_arena, int size) {
+		arena = _arena;
+		capacity = index = 0;
+		reserve(size);
+	}
+
+	// Makes room for at least size points at getX() & getY(). If the arrays are full, new ones are started, so
+	// points written before a reserve stay where they are but the next points may not follow them.
+	void reserve(int size) {
+		if (index + size <= capacity) return;
+		capacity = MAX(size, 2 * capacity);
+		x = arena->allocate<float>(capacity);
+		y = arena->allocate<float>(capacity);
 		index = 0;
-	} //end-BufferManager
+	}
 
-	~BufferManager() {
-		delete[] x;
-		delete[] y;
-	} //end-~BufferManager  
-
-	double *getX() { return &x[index]; }
-	double *getY() { return &y[index]; }
+	float *getX() { return &x[index]; }
+	float *getY() { return &y[index]; }
 	void move(int size) { index += size; }
 };
 
@@ -199,6 +193,7 @@ struct Info {
 class EDCircles: public EDPF {
 public:
 	EDCircles(cv::Mat srcImage);
+	EDCircles(cv::Mat srcImage, const EDRegions &regions);
 	EDCircles(ED obj);
 	EDCircles(EDColor obj);
 
@@ -215,41 +210,44 @@ private:
 	std::vector<mCircle> circles;
 	std::vector<mEllipse> ellipses;
 
-	Circle *circles1;
-	Circle *circles2;
-	Circle *circles3;
-	int noCircles1;
-	int noCircles2;
-	int noCircles3;
+	// Scratch of a detection, all in one arena: the workspace's if ED had one (reused across frames), else ownArena
+	EDArena ownArena;
+	EDArena *arena;
+
+	EDArenaArray<Circle> circles1;
+	EDArenaArray<Circle> circles2;
+	EDArenaArray<Circle> circles3;
 
-	EDArcs *edarcs1;
-	EDArcs *edarcs2;
-	EDArcs *edarcs3;
-	EDArcs *edarcs4;
+	EDArenaArray<MyArc> edarcs1;
+	EDArenaArray<MyArc> edarcs2;
+	EDArenaArray<MyArc> edarcs3;
+	EDArenaArray<MyArc> edarcs4;
 
 	int *segmentStartLines;
-	BufferManager *bm;
+	BufferManager bm;
 	Info *info;
-	NFALUT *nfa;
+	std::shared_ptr<const NFALUT> nfa; // see NFALUT::get
 
+	void DetectCircles(bool validate);
 	void GenerateCandidateCircles();
 	void DetectArcs(std::vector<LineSegment> lines);
 	void ValidateCircles();
+	void ValidateCircles(int first, int last, EDWorkspace *ws, char *valid);
 	void JoinCircles();
 	void JoinArcs1();
 	void JoinArcs2();
 	void JoinArcs3();
 	
 	// circle utility functions
-	static Circle *addCircle(Circle *circles, int &noCircles,double xc, double yc, double r, double circleFitError, double *x, double *y, int noPixels);
-	static Circle *addCircle(Circle *circles, int &noCircles,double xc, double yc, double r, double circleFitError, EllipseEquation *pEq, double ellipseFitError, double *x, double *y, int noPixels);
+	static Circle *addCircle(EDArenaArray<Circle> &circles, double xc, double yc, double r, double circleFitError, float *x, float *y, int noPixels);
+	static Circle *addCircle(EDArenaArray<Circle> &circles, double xc, double yc, double r, double circleFitError, EllipseEquation *pEq, double ellipseFitError, float *x, float *y, int noPixels);
 	static void sortCircles(Circle *circles, int noCircles);
-	static bool CircleFit(double *x, double *y, int N, double *pxc, double *pyc, double *pr, double *pe);
+	static bool CircleFit(float *x, float *y, int N, double *pxc, double *pyc, double *pr, double *pe);
 	static void ComputeCirclePoints(double xc, double yc, double r, double *px, double *py, int *noPoints);
 	static void sortCircle(Circle *circles, int noCircles);
 	
 	// ellipse utility functions
-	static bool EllipseFit(double *x, double *y, int noPoints, EllipseEquation *pResult, int mode=FPF);
+	static bool EllipseFit(float *x, float *y, int noPoints, EllipseEquation *pResult, int mode=FPF);
 	static double **AllocateMatrix(int noRows, int noColumns);
 	static void A_TperB(double **_A, double **_B, double **_res, int _righA, int _colA, int _righB, int _colB);
 	static void choldc(double **a, int n, double **l);
@@ -260,24 +258,24 @@ private:
 	static void jacobi(double **a, int n, double d[], double **v, int nrot);
 	static void ROTATE(double **a, int i, int j, int k, int l, double tau, double s);
 	static double computeEllipsePerimeter(EllipseEquation *eq);
-	static double ComputeEllipseError(EllipseEquation *eq, double *px, double *py, int noPoints);
+	static double ComputeEllipseError(EllipseEquation *eq, float *px, float *py, int noPoints);
 	static double ComputeEllipseCenterAndAxisLengths(EllipseEquation *eq, double *pxc, double *pyc, double *pmajorAxisLength, double *pminorAxisLength);
 	static void ComputeEllipsePoints(double *pvec, double *px, double *py, int noPoints);
 
 	// arc utility functions
 	static void joinLastTwoArcs(MyArc *arcs, int &noArcs);
-	static void addArc(MyArc *arcs, int &noArchs,double xc, double yc, double r, double circleFitError, // Circular arc
+	static void addArc(EDArenaArray<MyArc> &arcs, double xc, double yc, double r, double circleFitError, // Circular arc
 		double sTheta, double eTheta, int turn, int segmentNo,
 		int sx, int sy, int ex, int ey,
-		double *x, double *y, int noPixels, double overlapRatio = 0.0);
-	static void addArc(MyArc *arcs, int &noArchs, double xc, double yc, double r, double circleFitError, // Elliptic arc
+		float *x, float *y, int noPixels, double overlapRatio = 0.0);
+	static void addArc(EDArenaArray<MyArc> &arcs, double xc, double yc, double r, double circleFitError, // Elliptic arc
 		double sTheta, double eTheta, int turn, int segmentNo,
 		EllipseEquation *pEq, double ellipseFitError,
 		int sx, int sy, int ex, int ey,
-		double *x, double *y, int noPixels, double overlapRatio = 0.0);
+		float *x, float *y, int noPixels, double overlapRatio = 0.0);
 
 	static void ComputeStartAndEndAngles(double xc, double yc, double r,
-		double *x, double *y, int len,
+		float *x, float *y, int len,
 		double *psTheta, double *peTheta);
 
 	static void sortArc(MyArc *arcs, int noArcs);
@@ -0,0 +1,305 @@
+#include "EDDetector.h"
+
+using namespace cv;
+using namespace std;
+
+EDDetector::EDDetector(GradientOperator _op, double _gradThresh, double _anchorThresh, int _scanInterval, int _minPathLen, double _sigma, bool _sumFlag)
+{
+	// Check parameters for sanity
+	if (_gradThresh < 0) _gradThresh = 0; // at least 1 on the gradient map (see ED::MapThreshold)
+	if (_anchorThresh < 0) _anchorThresh = 0;
+	if (_sigma < 1.0) _sigma = 1.0;
+
+	op = _op;
+	userGradThresh = _gradThresh;
+	userAnchorThresh = _anchorThresh;
+	scanInterval = _scanInterval;
+	minPathLen = _minPathLen;
+	sigma = _sigma;
+	sumFlag = _sumFlag;
+	workspace = &ownWorkspace;
+	ownThreadPool = NULL;
+	incremental = false;
+	incTileSize = incDiffThresh = 0;
+	memset(&incStats, 0, sizeof(incStats));
+	pyramidScale = pyramidCorridor = 0;
+	chainCodeOutput = false;
+
+	width = height = 0;
+	segmentNos = 0;
+}
+
+EDDetector::~EDDetector()
+{
+	delete ownThreadPool;
+}
+
+void EDDetector::detect(const Mat &_srcImage)
+{
+	srcImage = _srcImage;
+
+	if (incremental && srcImage.depth() == CV_8U)
+		DetectIncrementally();
+	else if (pyramidScale > 1)
+		DetectByPyramid();
+	else
+		DetectEdges();
+
+	if (chainCodeOutput) {
+		chainCodes.assign(segmentPoints);
+		segmentPoints.clear(); // keeps its storage for the next frame
+	} //end-if
+}
+
+void EDDetector::setFusedPipeline(bool fused, int _bandHeight)
+{
+	fusedPipeline = fused;
+	bandHeight = _bandHeight < 0 ? 0 : _bandHeight;
+}
+
+void EDDetector::setThreadPool(ThreadPool *pool)
+{
+	threadPool = pool;
+}
+
+void EDDetector::setNumThreads(int noThreads)
+{
+	delete ownThreadPool;
+	ownThreadPool = noThreads > 1 ? new ThreadPool(noThreads) : NULL;
+	threadPool = ownThreadPool;
+}
+
+void EDDetector::setTiledLinking(bool tiled, int _tileSize)
+{
+	tiledLinking = tiled;
+	tileSize = _tileSize < 0 ? 0 : _tileSize;
+}
+
+EDTileLinkStats EDDetector::getTileLinkStats()
+{
+	return tileStats;
+}
+
+void EDDetector::setLinkMemoryCap(size_t bytes)
+{
+	maxLinkMemory = bytes;
+}
+
+int EDDetector::getTruncatedWalkNo()
+{
+	return noTruncatedWalks;
+}
+
+void EDDetector::setRegions(const EDRegions &_regions)
+{
+	regions = _regions;
+}
+
+void EDDetector::setIncremental(bool _incremental, int tileSize, int diffThresh)
+{
+	incremental = _incremental;
+	incTileSize = tileSize < 0 ? 0 : tileSize;
+	incDiffThresh = diffThresh < 0 ? 0 : diffThresh;
+	resetIncremental();
+}
+
+void EDDetector::resetIncremental()
+{
+	refSmooth.release();
+	lastSegments.clear();
+	memset(&incStats, 0, sizeof(incStats));
+}
+
+EDIncrementalStats EDDetector::getIncrementalStats()
+{
+	return incStats;
+}
+
+//-----------------------------------------------------------------------------------------
+// Incremental detection of a video frame (see setIncremental)
+//
+void EDDetector::DetectIncrementally()
+{
+	height = srcImage.rows;
+	width = srcImage.cols;
+
+	int T = incTileSize > 0 ? incTileSize : 32;
+	int diffThresh = incDiffThresh > 0 ? incDiffThresh : 8;
+	int tileCols = (width + T - 1) / T;
+	int tileRows = (height + T - 1) / T;
+	int noTiles = tileCols*tileRows;
+
+	// Smooth the frame into the workspace buffer that DetectEdges works on
+	Mat smooth(height, width, CV_8UC1, workspace->getSmoothImg(width*height));
+	if (sigma == 1.0)
+		GaussianBlur(srcImage, smooth, Size(5, 5), sigma);
+	else
+		GaussianBlur(srcImage, smooth, Size(), sigma); // calculate kernel from sigma
+
+	bool full = refSmooth.rows != height || refSmooth.cols != width;
+
+	// A tile changed if one of its smoothed pixels moved by more than diffThresh since the tile was last detected
+	vector<char> changed(noTiles, full ? 1 : 0);
+	if (!full) {
+		for (int t = 0; t < noTiles; t++) {
+			int r0 = (t / tileCols)*T, c0 = (t % tileCols)*T;
+			int r1 = MIN(r0 + T, height), c1 = MIN(c0 + T, width);
+
+			for (int i = r0; i < r1 && !changed[t]; i++) {
+				const uchar *a = smooth.ptr<uchar>(i);
+				const uchar *b = refSmooth.ptr<uchar>(i);
+				for (int j = c0; j < c1; j++) if (abs(a[j] - b[j]) > diffThresh) { changed[t] = 1; break; }
+			} //end-for
+		} //end-for
+	} //end-if
+
+	// Changed tiles & a margin of one tile around them
+	vector<char> recompute(noTiles, 0);
+	for (int t = 0; t < noTiles; t++) {
+		if (!changed[t]) continue;
+
+		int tr = t / tileCols, tc = t % tileCols;
+		for (int i = MAX(tr - 1, 0); i <= MIN(tr + 1, tileRows - 1); i++)
+			for (int j = MAX(tc - 1, 0); j <= MIN(tc + 1, tileCols - 1); j++) recompute[i*tileCols + j] = 1;
+	} //end-for
+
+	// Segments reaching into those tiles are detected again, together with all tiles they cross; the others are kept
+	vector<char> dirty = recompute;
+	EDSegments kept;
+	if (!full) {
+		for (int k = 0; k < lastSegments.size(); k++) {
+			EDSegmentView segment = lastSegments[k];
+
+			bool touches = false;
+			for (int l = 0; l < segment.size() && !touches; l++) touches = dirty[(segment[l].y / T)*tileCols + segment[l].x / T] != 0;
+
+			if (touches)
+				for (int l = 0; l < segment.size(); l++) recompute[(segment[l].y / T)*tileCols + segment[l].x / T] = 1;
+			else
+				kept.append(segment);
+		} //end-for
+	} //end-if
+
+	recomputeMask.create(height, width, CV_8UC1);
+	recomputeMask.setTo(Scalar(0));
+
+	int noChanged = 0, noRecomputed = 0;
+	for (int t = 0; t < noTiles; t++) {
+		noChanged += changed[t];
+		if (!recompute[t]) continue;
+
+		Rect tile = Rect((t % tileCols)*T, (t / tileCols)*T, T, T) & Rect(0, 0, width, height);
+		recomputeMask(tile).setTo(Scalar(255));
+		noRecomputed++;
+	} //end-for
+
+	// Detect in the recomputed tiles only, around the kept segments
+	EDRegions userRegions = regions;
+	regions = EDRegions(recomputeMask);
+	presmoothed = true;
+	keptSegments = &kept;
+
+	DetectEdges();
+
+	regions = userRegions;
+	regionRects.clear(); // the result covers the whole frame (e.g. for EDLines & EDCircles built from it)
+	presmoothed = false;
+	keptSegments = NULL;
+
+	// The recomputed tiles are the new reference
+	if (full)
+		smooth.copyTo(refSmooth);
+	else {
+		for (int t = 0; t < noTiles; t++) {
+			if (!recompute[t]) continue;
+
+			Rect tile = Rect((t % tileCols)*T, (t / tileCols)*T, T, T) & Rect(0, 0, width, height);
+			Mat dst = refSmooth(tile);
+			smooth(tile).copyTo(dst);
+		} //end-for
+	} //end-else
+
+	lastSegments = segmentPoints;
+
+	incStats.noTiles = noTiles;
+	incStats.noChangedTiles = noChanged;
+	incStats.noRecomputedTiles = noRecomputed;
+	incStats.noReusedSegments = kept.size();
+	incStats.noRecomputedSegments = segmentNos - kept.size();
+	incStats.reuseRatio = 1.0 - (double)noRecomputed / noTiles;
+}
+
+void EDDetector::setPyramid(int scale, int corridor)
+{
+	pyramidScale = scale < 1 ? 1 : scale;
+	pyramidCorridor = corridor < 0 ? 0 : corridor;
+}
+
+//-----------------------------------------------------------------------------------------
+// Coarse-to-fine detection (see setPyramid)
+//
+void EDDetector::DetectByPyramid()
+{
+	int s = pyramidScale;
+	int w = srcImage.cols / s, h = srcImage.rows / s;
+	if (w < 8 || h < 8) { DetectEdges(); return; } // too small to bother
+
+	// Coarse level: every coarse pixel averages an s x s block of the frame
+	resize(srcImage, smallImage, Size(w, h), 0, 0, INTER_AREA);
+	ED coarse(smallImage, op, userGradThresh, userAnchorThresh, scanInterval, MAX(2, minPathLen / s), sigma, sumFlag, workspace);
+
+	// Corridor around the coarse segments, in full resolution
+	int m = pyramidCorridor > 0 ? pyramidCorridor : 2 * s;
+	int fw = srcImage.cols, fh = srcImage.rows;
+	corridorMask.create(fh, fw, CV_8UC1);
+	corridorMask.setTo(Scalar(0));
+
+	const EDSegments &segments = coarse.getSegmentList();
+	const Point *p = segments.data();
+	for (int k = 0; k < segments.totalPoints(); k++) {
+		int r0 = MAX(p[k].y*s - m, 0), r1 = MIN((p[k].y + 1)*s + m, fh);
+		int c0 = MAX(p[k].x*s - m, 0), c1 = MIN((p[k].x + 1)*s + m, fw);
+		for (int i = r0; i < r1; i++) memset(corridorMask.ptr<uchar>(i) + c0, 255, c1 - c0);
+	} //end-for
+
+	// User regions still apply
+	EDRegions userRegions = regions;
+	if (!userRegions.mask.empty()) {
+		for (int i = 0; i < fh; i++) {
+			uchar *c = corridorMask.ptr<uchar>(i);
+			const uchar *u = userRegions.mask.ptr<uchar>(i);
+			for (int j = 0; j < fw; j++) c[j] = u[j] ? c[j] : 0;
+		} //end-for
+	} //end-if
+
+	// Fine level: full resolution ED in the corridor only
+	regions.mask = corridorMask;
+	DetectEdges();
+
+	// EDLines & EDCircles built from the result work on the user regions (if any), not on the corridor
+	regions = userRegions;
+	regionRects.clear();
+	if (!regions.empty()) ComputeRegionRects();
+}
+
+vector<EDSegments> EDDetector::sweep(const Mat &_srcImage, const vector<EDSweepParams> &params)
+{
+	srcImage = _srcImage;
+
+	return DetectSweep(params);
+}
+
+void EDDetector::setChainCodeOutput(bool _chainCodeOutput)
+{
+	chainCodeOutput = _chainCodeOutput;
+}
+
+void EDDetector::setSegmentSink(EDSegmentSink *sink)
+{
+	segmentSink = sink;
+}
+
+EDWorkspace * EDDetector::getWorkspace()
+{
+	return workspace;
+}
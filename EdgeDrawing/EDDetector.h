@@ -0,0 +1,120 @@
+/**************************************************************************************************************
+* Reusable Edge Drawing (ED) detector for video & batch processing.
+*
+* Owns an EDWorkspace and runs ED on consecutive frames without reallocating scratch buffers.
+* EDLines & EDCircles constructed from the detector run off the same workspace.
+**************************************************************************************************************/
+
+#ifndef _EDDetector_
+#define _EDDetector_
+
+#include "ED.h"
+
+// Report of the incremental video mode (see EDDetector::setIncremental) for the last frame
+struct EDIncrementalStats {
+	int noTiles;
+	int noChangedTiles;       // tiles whose smoothed image changed since they were last detected
+	int noRecomputedTiles;    // changed tiles, a margin of one tile around them & the tiles of the segments crossing them
+	int noReusedSegments;     // segments carried over from the previous frame
+	int noRecomputedSegments; // segments detected again
+	double reuseRatio;        // fraction of the frame reused: 1 - noRecomputedTiles / noTiles
+};
+
+class EDDetector : public ED {
+public:
+	EDDetector(GradientOperator _op = PREWITT_OPERATOR, double _gradThresh = 20, double _anchorThresh = 0, int _scanInterval = 1, int _minPathLen = 10, double _sigma = 1.0, bool _sumFlag = true);
+	~EDDetector();
+
+	// Detects edge segments of the given frame. Results (edge/smooth/grad images and segments) stay valid until the next call.
+	void detect(const cv::Mat &_srcImage);
+
+	// Streams smoothing, gradient & anchor computation over bands of rows (0: band height chosen from the image width).
+	// Results are identical; only the full smoothed image is not kept (getSmoothImage() returns an empty image).
+	// 8-bit frames only; 16-bit & float frames are smoothed in full (band-parallel still applies, see setThreadPool).
+	void setFusedPipeline(bool fused, int bandHeight = 0);
+
+	// Computes gradient & anchors band-parallel on the given pool (NULL: serial), for frames of any depth.
+	// The pool is not owned.
+	void setThreadPool(ThreadPool *pool);
+
+	// Same as above on a pool of noThreads workers owned by the detector (0 or 1: serial).
+	void setNumThreads(int noThreads);
+
+	// Links anchors tile by tile (in parallel if a thread pool is set) and stitches segments across tile borders
+	// (0: tile size chosen automatically). Results may differ slightly from serial linking near tile borders;
+	// getTileLinkStats() reports how much for the last frame.
+	void setTiledLinking(bool tiled, int tileSize = 0);
+	EDTileLinkStats getTileLinkStats();
+
+	// Caps the scratch memory of a single linking walk (pixel, stack & chain buffers, which otherwise grow
+	// with the longest walk). A walk that would need more is cut short (0: no cap).
+	void setLinkMemoryCap(size_t bytes);
+	int getTruncatedWalkNo(); // walks cut short by the cap in the last frame
+
+	// Restricts detection to the given rectangles and/or mask (see EDRegions); an empty EDRegions detects on the whole frame.
+	// Smoothing, gradient, anchors & linking then only cost in proportion to the region area.
+	void setRegions(const EDRegions &_regions);
+
+	// Incremental video mode for static cameras. Each frame is smoothed and compared tile by tile with the smoothed
+	// image the tile was last detected on. Only tiles that changed by more than diffThresh gray levels, a margin of
+	// one tile around them and the tiles of the segments crossing them are detected again; all other segments are
+	// carried over from the previous frame (0: tile size / threshold chosen automatically).
+	// Detection runs in region mode (see setRegions, which is ignored meanwhile), so the gradient image and the
+	// anchors only cover the recomputed tiles. Segments near recomputed tiles may differ slightly from full detection.
+	// 8-bit frames only; 16-bit & float frames are detected in full.
+	void setIncremental(bool incremental, int tileSize = 0, int diffThresh = 0);
+	void resetIncremental(); // the next frame is detected in full
+	EDIncrementalStats getIncrementalStats();
+
+	// Pyramid mode: ED first runs on the frame downscaled by scale (2, 4, ...) and then again at full resolution,
+	// but only inside a corridor of corridor pixels around the coarse segments (0: corridor of 2*scale pixels;
+	// scale 0 or 1: off). Edge locations stay full resolution while full resolution work is only done near edges.
+	// Edges too weak or too short to show up at the coarse level are lost. Not used in incremental mode.
+	void setPyramid(int scale, int corridor = 0);
+
+	// Parameter sweep: detects the frame once per parameter set, with the detector's operator, sigma & sumFlag.
+	// The frame is smoothed & differentiated only once; anchors & linking run per set, in parallel if a thread pool
+	// is set. Each result equals a separate detection with that set (region, fused, tiled, incremental & pyramid modes
+	// do not apply). Afterwards getSmoothImage() & getGradImage() show the frame, which has no segments of its own.
+	std::vector<EDSegments> sweep(const cv::Mat &_srcImage, const std::vector<EDSweepParams> &params);
+
+	// Delivers the segments of every frame as chain codes only (getChainCodes()), ~20x smaller than cv::Points.
+	// getSegmentList() & the other cv::Point accessors are then empty. EDLines built from the detector reads the
+	// chain codes directly; EDPF & EDCircles decode them. Linking still builds the cv::Point form (in storage reused
+	// across frames), so this shrinks what a frame hands on, e.g. to copies of the detector, not the detection's peak.
+	void setChainCodeOutput(bool chainCodeOutput);
+
+	// Streams the segments of every frame to sink as they are finalized (NULL: off), see EDSegmentSink. Serial and
+	// region linking deliver each segment right after linking it; tiled linking & incremental mode deliver all
+	// segments at the end of the frame. The sink is not owned.
+	void setSegmentSink(EDSegmentSink *sink);
+
+	EDWorkspace *getWorkspace();
+
+private:
+	EDDetector(const EDDetector &) = delete;
+	EDDetector &operator=(const EDDetector &) = delete;
+
+	void DetectIncrementally();
+	void DetectByPyramid();
+
+	EDWorkspace ownWorkspace;
+	ThreadPool *ownThreadPool;
+
+	bool incremental;
+	int incTileSize;
+	int incDiffThresh;
+	cv::Mat refSmooth; // smoothed image each tile was last detected on
+	cv::Mat recomputeMask;
+	EDSegments lastSegments; // segments of the previous frame
+	EDIncrementalStats incStats;
+
+	int pyramidScale;
+	int pyramidCorridor;
+	cv::Mat smallImage; // the downscaled frame
+	cv::Mat corridorMask;
+
+	bool chainCodeOutput;
+};
+
+#endif
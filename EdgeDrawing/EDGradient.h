@@ -0,0 +1,371 @@
+/**************************************************************************************************************
+* Gradient kernels used by Edge Drawing (ED).
+*
+* Every gradient operator is a separate template instance, so the per-pixel operator switch disappears
+* from the inner loop. Rows are processed 16 (SSE2, two blocks of 8) or 32 (AVX2, two blocks of 16) pixels at a time when the
+* compiler targets those instruction sets; otherwise, and for the last pixels of each row, the scalar kernel is used.
+* Both paths produce bit-identical gradient & direction maps.
+* 16-bit & float images use scalar kernels whose gradients are scaled to fit the 16-bit gradient map (exactly
+* for 16-bit images of up to 12-bit range with Prewitt & Sobel, see ED.h).
+**************************************************************************************************************/
+
+#ifndef _EDGradient_
+#define _EDGradient_
+
+#include <opencv2/opencv.hpp>
+#include <math.h>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ED_GRADIENT_AVX2
+#define ED_GRADIENT_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ED_GRADIENT_SSE2
+#endif
+
+#ifndef EDGE_VERTICAL
+#define EDGE_VERTICAL   1
+#define EDGE_HORIZONTAL 2
+#endif
+
+enum GradientOperator { PREWITT_OPERATOR = 101, SOBEL_OPERATOR = 102, SCHARR_OPERATOR = 103, LSD_OPERATOR = 104 };
+
+//----------------------------------------------------------------------------------------------
+// Scalar kernel. s points to the pixel whose gradient is computed.
+//
+// Prewitt, Sobel & Scharr use the 3x3 neighbourhood
+// A B C
+// D x E
+// F G H
+// com1 = (H-A), com2 = (C-F)
+// Prewitt: gx = com1 + com2 + (E-D)         gy = com1 - com2 + (G-B)
+// Sobel:   gx = com1 + com2 + 2*(E-D)       gy = com1 - com2 + 2*(G-B)
+// Scharr:  gx = 3*(com1 + com2) + 10*(E-D)  gy = 3*(com1 - com2) + 10*(G-B)
+//
+// LSD uses the 2x2 neighbourhood
+// A B
+// C D
+// com1 = (D-A), com2 = (B-C)
+// gx = com1 + com2, gy = com1 - com2
+//
+// T is the pixel type, A the accumulator (int for integer pixels, float for float pixels).
+//
+template <GradientOperator OP, class T, class A>
+inline void GradientAt(const T *s, int width, A &gx, A &gy)
+{
+	if (OP == LSD_OPERATOR) {
+		A com1 = (A)s[width + 1] - s[0];
+		A com2 = (A)s[1] - s[width];
+
+		gx = std::abs(com1 + com2);
+		gy = std::abs(com1 - com2);
+		return;
+	} //end-if
+
+	A com1 = (A)s[width + 1] - s[-width - 1];
+	A com2 = (A)s[-width + 1] - s[width - 1];
+	A ed = (A)s[1] - s[-1];
+	A gb = (A)s[width] - s[-width];
+
+	if (OP == PREWITT_OPERATOR) {
+		gx = std::abs(com1 + com2 + ed);
+		gy = std::abs(com1 - com2 + gb);
+	}
+	else if (OP == SOBEL_OPERATOR) {
+		gx = std::abs(com1 + com2 + 2 * ed);
+		gy = std::abs(com1 - com2 + 2 * gb);
+	}
+	else {
+		gx = std::abs(3 * (com1 + com2) + 10 * ed);
+		gy = std::abs(3 * (com1 - com2) + 10 * gb);
+	} //end-else
+}
+
+template <GradientOperator OP, bool SUM>
+inline void GradientPixel(const uchar *s, int width, int gradThresh, short *grad, uchar *dir)
+{
+	int gx, gy;
+	GradientAt<OP>(s, width, gx, gy);
+
+	int sum;
+	if (SUM)
+		sum = gx + gy;
+	else
+		sum = (int)sqrt((double)gx*gx + gy*gy);
+
+	*grad = sum;
+	if (sum >= gradThresh) *dir = gx >= gy ? EDGE_VERTICAL : EDGE_HORIZONTAL;
+	else                   *dir = 0;
+}
+
+#ifdef ED_GRADIENT_SSE2
+//----------------------------------------------------------------------------------------------
+// Vector helpers. Pixels are widened to 16-bit lanes; the largest Scharr response (16*255) still fits.
+//
+struct GradientSSE2 {
+	typedef __m128i V;
+	enum { N = 8 };
+
+	static inline V load(const uchar *p) { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128()); }
+	static inline V add(V a, V b) { return _mm_add_epi16(a, b); }
+	static inline V sub(V a, V b) { return _mm_sub_epi16(a, b); }
+	static inline V shl(V a, int n) { return _mm_slli_epi16(a, n); }
+	static inline V abs(V a) { return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a)); }
+	static inline V set1(int v) { return _mm_set1_epi16((short)v); }
+	static inline V cmpgt(V a, V b) { return _mm_cmpgt_epi16(a, b); }
+	static inline V and_(V a, V b) { return _mm_and_si128(a, b); }
+	static inline V andnot(V a, V b) { return _mm_andnot_si128(a, b); }
+
+	// (int)sqrt(gx*gx + gy*gy) computed exactly: float sqrt is off by at most one, then corrected in integers
+	static inline __m128i isqrt32(__m128i n)
+	{
+		__m128i s = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(n)));
+		__m128i one = _mm_set1_epi32(1);
+		s = _mm_sub_epi32(s, _mm_and_si128(_mm_cmpgt_epi32(_mm_madd_epi16(s, s), n), one));
+		__m128i s1 = _mm_add_epi32(s, one);
+		s = _mm_add_epi32(s, _mm_andnot_si128(_mm_cmpgt_epi32(_mm_madd_epi16(s1, s1), n), one));
+		return s;
+	}
+
+	static inline V magnitude(V gx, V gy)
+	{
+		__m128i lo = _mm_unpacklo_epi16(gx, gy);
+		__m128i hi = _mm_unpackhi_epi16(gx, gy);
+		return _mm_packs_epi32(isqrt32(_mm_madd_epi16(lo, lo)), isqrt32(_mm_madd_epi16(hi, hi)));
+	}
+
+	static inline void store(short *grad, uchar *dir, V sum, V d)
+	{
+		_mm_storeu_si128((__m128i *)grad, sum);
+		_mm_storel_epi64((__m128i *)dir, _mm_packus_epi16(d, d));
+	}
+};
+#endif
+
+#ifdef ED_GRADIENT_AVX2
+struct GradientAVX2 {
+	typedef __m256i V;
+	enum { N = 16 };
+
+	static inline V load(const uchar *p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p)); }
+	static inline V add(V a, V b) { return _mm256_add_epi16(a, b); }
+	static inline V sub(V a, V b) { return _mm256_sub_epi16(a, b); }
+	static inline V shl(V a, int n) { return _mm256_slli_epi16(a, n); }
+	static inline V abs(V a) { return _mm256_abs_epi16(a); }
+	static inline V set1(int v) { return _mm256_set1_epi16((short)v); }
+	static inline V cmpgt(V a, V b) { return _mm256_cmpgt_epi16(a, b); }
+	static inline V and_(V a, V b) { return _mm256_and_si256(a, b); }
+	static inline V andnot(V a, V b) { return _mm256_andnot_si256(a, b); }
+
+	static inline V magnitude(V gx, V gy)
+	{
+		__m128i lo = GradientSSE2::magnitude(_mm256_castsi256_si128(gx), _mm256_castsi256_si128(gy));
+		__m128i hi = GradientSSE2::magnitude(_mm256_extracti128_si256(gx, 1), _mm256_extracti128_si256(gy, 1));
+		return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+	}
+
+	static inline void store(short *grad, uchar *dir, V sum, V d)
+	{
+		_mm256_storeu_si256((__m256i *)grad, sum);
+		_mm_storeu_si128((__m128i *)dir, _mm_packus_epi16(_mm256_castsi256_si128(d), _mm256_extracti128_si256(d, 1)));
+	}
+};
+#endif
+
+#ifdef ED_GRADIENT_SSE2
+// Computes V::N consecutive pixels starting at s
+template <GradientOperator OP, bool SUM, class K>
+inline void GradientBlock(const uchar *s, int width, typename K::V thresh, short *grad, uchar *dir)
+{
+	typedef typename K::V V;
+	V gx, gy;
+
+	if (OP == LSD_OPERATOR) {
+		V com1 = K::sub(K::load(s + width + 1), K::load(s));
+		V com2 = K::sub(K::load(s + 1), K::load(s + width));
+
+		gx = K::abs(K::add(com1, com2));
+		gy = K::abs(K::sub(com1, com2));
+	}
+	else {
+		V com1 = K::sub(K::load(s + width + 1), K::load(s - width - 1));
+		V com2 = K::sub(K::load(s - width + 1), K::load(s + width - 1));
+		V ed = K::sub(K::load(s + 1), K::load(s - 1));
+		V gb = K::sub(K::load(s + width), K::load(s - width));
+
+		if (OP == PREWITT_OPERATOR) {
+			gx = K::abs(K::add(K::add(com1, com2), ed));
+			gy = K::abs(K::add(K::sub(com1, com2), gb));
+		}
+		else if (OP == SOBEL_OPERATOR) {
+			gx = K::abs(K::add(K::add(com1, com2), K::shl(ed, 1)));
+			gy = K::abs(K::add(K::sub(com1, com2), K::shl(gb, 1)));
+		}
+		else {
+			V sum = K::add(com1, com2);
+			V diff = K::sub(com1, com2);
+			gx = K::abs(K::add(K::add(sum, K::shl(sum, 1)), K::add(K::shl(ed, 3), K::shl(ed, 1))));
+			gy = K::abs(K::add(K::add(diff, K::shl(diff, 1)), K::add(K::shl(gb, 3), K::shl(gb, 1))));
+		} //end-else
+	} //end-else
+
+	V sum = SUM ? K::add(gx, gy) : K::magnitude(gx, gy);
+
+	// dir = EDGE_VERTICAL if gx >= gy, EDGE_HORIZONTAL otherwise; 0 for pixels below the threshold
+	V one = K::set1(1);
+	V d = K::add(one, K::and_(K::cmpgt(gy, gx), one));
+	d = K::andnot(K::cmpgt(thresh, sum), d);
+
+	K::store(grad, dir, sum, d);
+}
+#endif
+
+//----------------------------------------------------------------------------------------------
+// Computes gradient & direction for noRows consecutive rows and columns [colStart, colEnd).
+// smooth, grad & dir point to the first row to be processed; width is the row stride of all three.
+// smooth must have one valid row above and below the processed rows (and one valid column on either side);
+// it may be a small band of rows rather than the whole image.
+// Border columns are not touched.
+//
+template <GradientOperator OP, bool SUM>
+void ComputeGradientRows(const uchar *smooth, short *grad, uchar *dir, int width, int gradThresh, int noRows, int colStart, int colEnd)
+{
+	for (int i = 0; i < noRows; i++) {
+		int j = colStart;
+		const uchar *s = smooth + i*width;
+		short *g = grad + i*width;
+		uchar *d = dir + i*width;
+
+#if defined(ED_GRADIENT_AVX2)
+		__m256i thresh256 = _mm256_set1_epi16((short)gradThresh);
+		for (; j + 2 * GradientAVX2::N <= colEnd; j += 2 * GradientAVX2::N) {
+			GradientBlock<OP, SUM, GradientAVX2>(s + j, width, thresh256, g + j, d + j);
+			GradientBlock<OP, SUM, GradientAVX2>(s + j + GradientAVX2::N, width, thresh256, g + j + GradientAVX2::N, d + j + GradientAVX2::N);
+		} //end-for
+#endif
+
+#if defined(ED_GRADIENT_SSE2)
+		__m128i thresh128 = _mm_set1_epi16((short)gradThresh);
+		for (; j + 2 * GradientSSE2::N <= colEnd; j += 2 * GradientSSE2::N) {
+			GradientBlock<OP, SUM, GradientSSE2>(s + j, width, thresh128, g + j, d + j);
+			GradientBlock<OP, SUM, GradientSSE2>(s + j + GradientSSE2::N, width, thresh128, g + j + GradientSSE2::N, d + j + GradientSSE2::N);
+		} //end-for
+
+		for (; j + GradientSSE2::N <= colEnd; j += GradientSSE2::N)
+			GradientBlock<OP, SUM, GradientSSE2>(s + j, width, thresh128, g + j, d + j);
+#endif
+
+		for (; j < colEnd; j++)
+			GradientPixel<OP, SUM>(s + j, width, gradThresh, g + j, d + j);
+	} //end-for
+}
+
+// Selects the template instance for the given operator. By default all columns but the border ones are processed.
+inline void ComputeGradientRows(GradientOperator op, bool sumFlag, const uchar *smooth, short *grad, uchar *dir, int width, int gradThresh, int noRows, int colStart = 1, int colEnd = -1)
+{
+	if (colEnd < 0) colEnd = width - 1;
+
+	switch (op) {
+	case PREWITT_OPERATOR:
+		if (sumFlag) ComputeGradientRows<PREWITT_OPERATOR, true>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		else         ComputeGradientRows<PREWITT_OPERATOR, false>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		break;
+	case SOBEL_OPERATOR:
+		if (sumFlag) ComputeGradientRows<SOBEL_OPERATOR, true>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		else         ComputeGradientRows<SOBEL_OPERATOR, false>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		break;
+	case SCHARR_OPERATOR:
+		if (sumFlag) ComputeGradientRows<SCHARR_OPERATOR, true>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		else         ComputeGradientRows<SCHARR_OPERATOR, false>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		break;
+	case LSD_OPERATOR:
+		if (sumFlag) ComputeGradientRows<LSD_OPERATOR, true>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		else         ComputeGradientRows<LSD_OPERATOR, false>(smooth, grad, dir, width, gradThresh, noRows, colStart, colEnd);
+		break;
+	} //end-switch
+}
+
+//----------------------------------------------------------------------------------------------
+// Kernels for 16-bit & float pixels (scalar only).
+// Their gradients do not fit the 16-bit gradient map as they are, so they are multiplied by gradScale,
+// which the caller chooses such that the largest possible gradient of the image still fits. A scale below 1
+// (a 16-bit range wider than SHRT_MAX / MaxGradient(op, 1)) truncates the gradients to multiples of 1/gradScale.
+// The direction is decided on the unscaled gradient.
+//
+template <GradientOperator OP, bool SUM, class T>
+inline void GradientPixelScaled(const T *s, int width, int gradThresh, float gradScale, short *grad, uchar *dir)
+{
+	typedef typename std::conditional<std::is_floating_point<T>::value, float, int>::type A;
+	A gx, gy;
+	GradientAt<OP>(s, width, gx, gy);
+
+	double sum;
+	if (SUM)
+		sum = (double)gx + gy;
+	else
+		sum = sqrt((double)gx*gx + (double)gy*gy);
+
+	int g = (int)(sum*gradScale);
+	if (g > SHRT_MAX) g = SHRT_MAX;
+
+	*grad = g;
+	if (g >= gradThresh) *dir = gx >= gy ? EDGE_VERTICAL : EDGE_HORIZONTAL;
+	else                 *dir = 0;
+}
+
+// Same as ComputeGradientRows for 16-bit & float pixels
+template <GradientOperator OP, bool SUM, class T>
+void ComputeGradientRowsScaled(const T *smooth, short *grad, uchar *dir, int width, int gradThresh, float gradScale, int noRows, int colStart, int colEnd)
+{
+	for (int i = 0; i < noRows; i++) {
+		const T *s = smooth + i*width;
+		short *g = grad + i*width;
+		uchar *d = dir + i*width;
+
+		for (int j = colStart; j < colEnd; j++)
+			GradientPixelScaled<OP, SUM>(s + j, width, gradThresh, gradScale, g + j, d + j);
+	} //end-for
+}
+
+template <class T>
+inline void ComputeGradientRowsScaled(GradientOperator op, bool sumFlag, const T *smooth, short *grad, uchar *dir, int width, int gradThresh, float gradScale, int noRows, int colStart = 1, int colEnd = -1)
+{
+	if (colEnd < 0) colEnd = width - 1;
+
+	switch (op) {
+	case PREWITT_OPERATOR:
+		if (sumFlag) ComputeGradientRowsScaled<PREWITT_OPERATOR, true>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		else         ComputeGradientRowsScaled<PREWITT_OPERATOR, false>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		break;
+	case SOBEL_OPERATOR:
+		if (sumFlag) ComputeGradientRowsScaled<SOBEL_OPERATOR, true>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		else         ComputeGradientRowsScaled<SOBEL_OPERATOR, false>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		break;
+	case SCHARR_OPERATOR:
+		if (sumFlag) ComputeGradientRowsScaled<SCHARR_OPERATOR, true>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		else         ComputeGradientRowsScaled<SCHARR_OPERATOR, false>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		break;
+	case LSD_OPERATOR:
+		if (sumFlag) ComputeGradientRowsScaled<LSD_OPERATOR, true>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		else         ComputeGradientRowsScaled<LSD_OPERATOR, false>(smooth, grad, dir, width, gradThresh, gradScale, noRows, colStart, colEnd);
+		break;
+	} //end-switch
+}
+
+// Largest gradient (|gx| + |gy|, which also bounds the magnitude) of an image whose pixel values span range
+inline double MaxGradient(GradientOperator op, double range)
+{
+	switch (op) {
+	case PREWITT_OPERATOR: return 6 * range;
+	case SOBEL_OPERATOR:   return 8 * range;
+	case SCHARR_OPERATOR:  return 32 * range;
+	default:               return 4 * range;
+	} //end-switch
+}
+
+#endif
@@ -6,5 +6,8 @@
 #include "EDLines.h"
 #include "EDCircles.h"
 #include "EDColor.h"
+#include "EDDetector.h"
+#include "EDBatch.h"
+#include "EDLineTracker.h"
 
 #endif
\ No newline at end of file
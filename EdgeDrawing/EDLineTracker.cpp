@@ -0,0 +1,278 @@
+#include "EDLineTracker.h"
+#include <climits>
+#include <functional>
+
+using namespace cv;
+using namespace std;
+
+EDLineTracker::EDLineTracker(int _corridor, int _fullInterval, double _maxDistance, int _maxMissed, double _line_error, int _min_line_len, double _max_distance_between_two_lines, double _max_error)
+	: detector(SOBEL_OPERATOR, 36, 8) // EDLines' ED parameters
+{
+	// Check parameters for sanity
+	if (_corridor < 1) _corridor = 1;
+	if (_fullInterval < 1) _fullInterval = 1;
+	if (_maxDistance < 1.0) _maxDistance = 1.0;
+	if (_maxMissed < 0) _maxMissed = 0;
+
+	corridor = _corridor;
+	fullInterval = _fullInterval;
+	maxDistance = _maxDistance;
+	maxMissed = _maxMissed;
+
+	line_error = _line_error;
+	min_line_len = _min_line_len;
+	max_distance_between_two_lines = _max_distance_between_two_lines;
+	max_error = _max_error;
+
+	nextId = 0;
+	framesSinceFull = 0;
+	fullFrame = false;
+}
+
+const vector<EDTrackedLine> &EDLineTracker::track(const Mat &frame)
+{
+	CV_Assert(frame.channels() == 1);
+
+	int width = frame.cols, height = frame.rows;
+	bool sizeChanged = corridorMask.rows != height || corridorMask.cols != width;
+	if (sizeChanged) {
+		corridorMask.create(height, width, CV_8UC1);
+		if (!tracks.empty()) reset();
+	} //end-if
+
+	// Constant velocity prediction
+	vector<LS> predicted;
+	predicted.reserve(tracks.size());
+	for (size_t k = 0; k < tracks.size(); k++)
+		predicted.push_back(LS(tracks[k].line.start + tracks[k].startVelocity, tracks[k].line.end + tracks[k].endVelocity));
+
+	fullFrame = tracks.empty() || framesSinceFull + 1 >= fullInterval;
+	if (fullFrame) {
+		detector.setRegions(EDRegions());
+		framesSinceFull = 0;
+	}
+	else {
+		BuildCorridors(predicted, width, height);
+		detector.setRegions(EDRegions(corridorMask));
+		framesSinceFull++;
+	} //end-else
+
+	detector.detect(frame);
+	EDLines edlines(detector, line_error, min_line_len, max_distance_between_two_lines, max_error);
+
+	Match(predicted, edlines.getLines(), width, height);
+
+	return tracks;
+}
+
+void EDLineTracker::reset()
+{
+	tracks.clear();
+	framesSinceFull = 0;
+}
+
+bool EDLineTracker::lastFrameWasFull()
+{
+	return fullFrame;
+}
+
+EDDetector &EDLineTracker::getDetector()
+{
+	return detector;
+}
+
+//-----------------------------------------------------------------------------------------
+// Marks a corridor of corridor pixels around every predicted line in corridorMask
+//
+void EDLineTracker::BuildCorridors(const vector<LS> &predicted, int width, int height)
+{
+	corridorMask.setTo(Scalar(0));
+
+	int m = corridor;
+	for (size_t k = 0; k < predicted.size(); k++) {
+		Point2d p = predicted[k].start, d = predicted[k].end - predicted[k].start;
+		int noSteps = (int)MAX(fabs(d.x), fabs(d.y)) + 1; // steps of at most one pixel
+
+		int lastX = INT_MIN, lastY = INT_MIN;
+		for (int s = 0; s <= noSteps; s++) {
+			int x = (int)floor(p.x + d.x*s / noSteps + 0.5);
+			int y = (int)floor(p.y + d.y*s / noSteps + 0.5);
+			if (x == lastX && y == lastY) continue;
+			lastX = x; lastY = y;
+
+			int r0 = MAX(y - m, 0), r1 = MIN(y + m + 1, height);
+			int c0 = MAX(x - m, 0), c1 = MIN(x + m + 1, width);
+			for (int i = r0; i < r1 && c0 < c1; i++) memset(corridorMask.ptr<uchar>(i) + c0, 255, c1 - c0);
+		} //end-for
+	} //end-for
+}
+
+//-----------------------------------------------------------------------------------------
+// Mean distance of the end points of line from the infinite line through predicted, or -1 if line is not a
+// continuation of predicted: an end point is more than maxDistance away or the two do not overlap
+//
+double EDLineTracker::MatchCost(const LS &predicted, const LS &line)
+{
+	double dx = predicted.end.x - predicted.start.x, dy = predicted.end.y - predicted.start.y;
+	double len = sqrt(dx*dx + dy*dy);
+	if (len < 1e-9) return -1;
+	dx /= len; dy /= len;
+
+	double sx = line.start.x - predicted.start.x, sy = line.start.y - predicted.start.y;
+	double ex = line.end.x - predicted.start.x, ey = line.end.y - predicted.start.y;
+
+	double d1 = fabs(sx*dy - sy*dx), d2 = fabs(ex*dy - ey*dx);
+	if (d1 > maxDistance || d2 > maxDistance) return -1;
+
+	double t1 = sx*dx + sy*dy, t2 = ex*dx + ey*dy;
+	if (MAX(t1, t2) < -maxDistance || MIN(t1, t2) > len + maxDistance) return -1;
+
+	return (d1 + d2) / 2;
+}
+
+//-----------------------------------------------------------------------------------------
+// Whether piece, a line that continues the track predicted at predicted (see MatchCost), is a piece of the same
+// edge as line, the line matched to that track. Along the track, a piece lies end to end with line (they overlap
+// by at most maxDistance) within the span of line & predicted; a parallel edge next to the track lies side by side.
+//
+bool EDLineTracker::IsFragment(const LS &line, const LS &piece, const LS &predicted)
+{
+	double dx = predicted.end.x - predicted.start.x, dy = predicted.end.y - predicted.start.y;
+	double len = sqrt(dx*dx + dy*dy);
+	if (len < 1e-9) return false;
+	dx /= len; dy /= len;
+
+	// Extents along the track
+	auto t = [&](const Point2d &p) { return (p.x - predicted.start.x)*dx + (p.y - predicted.start.y)*dy; };
+	double l0 = MIN(t(line.start), t(line.end)), l1 = MAX(t(line.start), t(line.end));
+	double p0 = MIN(t(piece.start), t(piece.end)), p1 = MAX(t(piece.start), t(piece.end));
+
+	if (MIN(l1, p1) - MAX(l0, p0) > maxDistance) return false; // side by side
+
+	return p0 >= MIN(l0, 0.0) - maxDistance && p1 <= MAX(l1, len) + maxDistance;
+}
+
+//-----------------------------------------------------------------------------------------
+// Motion of point p onto the infinite line through line. Only the motion across a line is observable: its end
+// points move along it as the line is cut or extended, so they are not used for prediction.
+//
+Point2d EDLineTracker::NormalMotion(const Point2d &p, const LS &line)
+{
+	double dx = line.end.x - line.start.x, dy = line.end.y - line.start.y;
+	double len2 = dx*dx + dy*dy;
+	if (len2 < 1e-18) return Point2d(0, 0);
+
+	double t = ((p.x - line.start.x)*dx + (p.y - line.start.y)*dy) / len2;
+	return Point2d(line.start.x + t*dx - p.x, line.start.y + t*dy - p.y);
+}
+
+//-----------------------------------------------------------------------------------------
+// Greedy one-to-one matching of the detected lines to the predicted tracks, cheapest pairs first.
+// Candidate pairs come from a grid of cells the predicted lines pass through.
+//
+void EDLineTracker::Match(const vector<LS> &predicted, const vector<LS> &lines, int width, int height)
+{
+	int noTracks = (int)tracks.size(), noLines = (int)lines.size();
+
+	// Any pair that may match has sample points within S of each other (samples are S/2 apart)
+	int S = MAX(32, (int)ceil(4 * maxDistance));
+	int gridCols = width / S + 3, gridRows = height / S + 3; // one extra cell for lines slightly outside the frame
+	vector<vector<int>> grid(gridCols*gridRows);
+
+	auto forEachCell = [&](const LS &l, const std::function<void(int, int)> &f) {
+		Point2d d = l.end - l.start;
+		int noSteps = (int)(2 * MAX(fabs(d.x), fabs(d.y)) / S) + 1;
+		int lastCol = INT_MIN, lastRow = INT_MIN;
+		for (int s = 0; s <= noSteps; s++) {
+			int col = MIN(MAX((int)floor((l.start.x + d.x*s / noSteps) / S) + 1, 0), gridCols - 1);
+			int row = MIN(MAX((int)floor((l.start.y + d.y*s / noSteps) / S) + 1, 0), gridRows - 1);
+			if (col == lastCol && row == lastRow) continue;
+			lastCol = col; lastRow = row;
+			f(col, row);
+		} //end-for
+	};
+
+	for (int k = 0; k < noTracks; k++)
+		forEachCell(predicted[k], [&](int col, int row) { grid[row*gridCols + col].push_back(k); });
+
+	struct Pair { double cost; int track, line; };
+	vector<Pair> pairs;
+	vector<int> seen(noTracks, -1);
+
+	for (int l = 0; l < noLines; l++) {
+		forEachCell(lines[l], [&](int col, int row) {
+			for (int i = MAX(row - 1, 0); i <= MIN(row + 1, gridRows - 1); i++) {
+				for (int j = MAX(col - 1, 0); j <= MIN(col + 1, gridCols - 1); j++) {
+					const vector<int> &cell = grid[i*gridCols + j];
+					for (size_t c = 0; c < cell.size(); c++) {
+						int k = cell[c];
+						if (seen[k] == l) continue;
+						seen[k] = l;
+
+						double cost = MatchCost(predicted[k], lines[l]);
+						if (cost >= 0) pairs.push_back({ cost, k, l });
+					} //end-for
+				} //end-for
+			} //end-for
+		});
+	} //end-for
+
+	sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) {
+		if (a.cost != b.cost) return a.cost < b.cost;
+		if (a.track != b.track) return a.track < b.track;
+		return a.line < b.line;
+	});
+
+	vector<char> trackMatched(noTracks, 0);
+	vector<int> trackLine(noTracks, -1); // line matched to each track
+	vector<char> lineMatched(noLines, 0);
+	for (size_t p = 0; p < pairs.size(); p++) {
+		int k = pairs[p].track, l = pairs[p].line;
+		if (trackMatched[k] || lineMatched[l]) continue;
+		trackMatched[k] = lineMatched[l] = 1;
+		trackLine[k] = l;
+	} //end-for
+
+	// An unmatched line that lies end to end with the line matched to one of its candidate tracks is a piece of the
+	// same edge (EDLines split it), not a new line. Any other unmatched line, e.g. a parallel edge next to the
+	// track, starts a new track.
+	vector<char> lineUsed(lineMatched);
+	for (size_t p = 0; p < pairs.size(); p++) {
+		int k = pairs[p].track, l = pairs[p].line;
+		if (!lineUsed[l] && trackLine[k] >= 0 && IsFragment(lines[trackLine[k]], lines[l], predicted[k])) lineUsed[l] = 1;
+	} //end-for
+
+	for (int k = 0; k < noTracks; k++) {
+		if (!trackMatched[k]) continue;
+
+		// Keep the end point order of the track
+		LS line = lines[trackLine[k]];
+		Point2d pd = predicted[k].end - predicted[k].start, ld = line.end - line.start;
+		if (pd.x*ld.x + pd.y*ld.y < 0) swap(line.start, line.end);
+
+		EDTrackedLine &t = tracks[k];
+		t.startVelocity = NormalMotion(t.line.start, line);
+		t.endVelocity = NormalMotion(t.line.end, line);
+		t.line = line;
+		t.missed = 0;
+	} //end-for
+
+	// Tracks not found coast on their prediction until they are dropped
+	int noKept = 0;
+	for (int k = 0; k < noTracks; k++) {
+		EDTrackedLine &t = tracks[k];
+		t.age++;
+		if (!trackMatched[k]) {
+			t.line = predicted[k];
+			if (++t.missed > maxMissed) continue;
+		} //end-if
+
+		if (noKept != k) tracks[noKept] = t;
+		noKept++;
+	} //end-for
+	tracks.erase(tracks.begin() + noKept, tracks.end());
+
+	// Lines not matched to any track start new tracks
+	for (int l = 0; l < noLines; l++)
+		if (!lineUsed[l]) tracks.push_back(EDTrackedLine(nextId++, lines[l]));
+}
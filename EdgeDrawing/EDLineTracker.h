@@ -0,0 +1,76 @@
+/**************************************************************************************************************
+* Line tracking over video frames.
+*
+* Runs EDLines on consecutive frames and gives every line an ID that it keeps while it is tracked. Each track is
+* predicted from its motion across the line between the last two frames (constant velocity). On most frames ED &
+* EDLines only run inside corridors around the predicted lines (see EDRegions), and the lines found there are matched
+* to the predictions. Every fullInterval frames, and whenever nothing is tracked, the whole frame is detected so that
+* new lines are picked up; until then a line growing out of its corridor is cut at the corridor's end.
+**************************************************************************************************************/
+
+#ifndef _EDLineTracker_
+#define _EDLineTracker_
+
+#include "EDDetector.h"
+#include "EDLines.h"
+
+struct EDTrackedLine {
+	int id;                     // unique over the tracker's lifetime
+	LS line;                    // position in the last frame (the predicted position if missed > 0)
+	cv::Point2d startVelocity;  // motion of line.start across the line per frame
+	cv::Point2d endVelocity;    // motion of line.end across the line per frame
+	int age;                    // frames since the line was first detected
+	int missed;                 // consecutive frames in which the line was not found
+
+	EDTrackedLine(int _id, const LS &_line) : id(_id), line(_line), age(0), missed(0) {}
+};
+
+class EDLineTracker {
+public:
+	// corridor: half width in pixels of the corridor detected around each predicted line
+	// fullInterval: every fullInterval-th frame is detected in full (1: every frame)
+	// maxDistance: a line continues a track if both its end points lie within maxDistance pixels of the predicted line
+	// maxMissed: a track is dropped after more than maxMissed consecutive frames without a match
+	// The remaining parameters are those of EDLines.
+	EDLineTracker(int _corridor = 6, int _fullInterval = 10, double _maxDistance = 3.0, int _maxMissed = 2, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3);
+
+	// Detects the lines of the next frame & matches them to the tracks. Returns the live tracks, including those
+	// missed in this frame (missed > 0). Results stay valid until the next call.
+	const std::vector<EDTrackedLine> &track(const cv::Mat &frame);
+
+	void reset(); // drops all tracks; the next frame is detected in full
+	bool lastFrameWasFull(); // whether the last frame was detected in full
+
+	// The detector the frames run on, e.g. to set a thread pool (its regions are set by the tracker)
+	EDDetector &getDetector();
+
+private:
+	EDLineTracker(const EDLineTracker &) = delete;
+	EDLineTracker &operator=(const EDLineTracker &) = delete;
+
+	void BuildCorridors(const std::vector<LS> &predicted, int width, int height);
+	void Match(const std::vector<LS> &predicted, const std::vector<LS> &lines, int width, int height);
+	double MatchCost(const LS &predicted, const LS &line);
+	bool IsFragment(const LS &line, const LS &piece, const LS &predicted);
+	static cv::Point2d NormalMotion(const cv::Point2d &p, const LS &line);
+
+	EDDetector detector;
+	cv::Mat corridorMask;
+
+	std::vector<EDTrackedLine> tracks;
+	int nextId;
+	int framesSinceFull;
+	bool fullFrame;
+
+	int corridor;
+	int fullInterval;
+	double maxDistance;
+	int maxMissed;
+
+	double line_error;
+	int min_line_len;
+	double max_distance_between_two_lines;
+	double max_error;
+};
+
+#endif
@@ -5,43 +5,31 @@
 using namespace cv;
 using namespace std;
 
-EDLines::EDLines(Mat srcImage ,  double _line_error, int _min_line_len, double _max_distance_between_two_lines , double _max_error)
+EDLines::EDLines(Mat srcImage ,  double _line_error, int _min_line_len, double _max_distance_between_two_lines , double _max_error, bool _quantizedAngles)
 	:ED(srcImage, SOBEL_OPERATOR, 36, 8) 
 {
+	ConvertTo8Bit(); // validation works on 8-bit pixels
+
 	min_line_len = _min_line_len;
 	line_error = _line_error;
 	max_distance_between_two_lines = _max_distance_between_two_lines;
 	max_error = _max_error;
+	quantizedAngles = _quantizedAngles;
+	angleMap = NULL;
 
 	if(min_line_len == -1) // If no initial value given, compute it 
-		min_line_len = ComputeMinLineLength();
+		min_line_len = ComputeMinLineLength(width, height);
 
 	if (min_line_len < 9) // avoids small line segments in the result. Might be deleted!
 		min_line_len = 9;
 
 
 
-	// Temporary buffers used during line fitting
-	size_t buffer_size = (width + height) * 8;
-	for (int segmentNumber = 0; segmentNumber < segmentPoints.size(); segmentNumber++) {
-		auto segment_size = segmentPoints[segmentNumber].size();
-		buffer_size = std::max(buffer_size, segment_size);
-	}
-	double* x = new double[buffer_size];
-	double* y = new double[buffer_size];
-
-	linesNo = 0;
+	EDWorkspace localWorkspace; // used only if no workspace is attached
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
 	
 	// Use the whole segment
-	for (int segmentNumber = 0; segmentNumber < segmentPoints.size(); segmentNumber++) {
-		int k = 0;
-		std::vector<Point> segment = segmentPoints[segmentNumber];
-		for (int k = 0; k < segment.size(); k++) {
-			x[k] = segment[k].x;
-			y[k] = segment[k].y;
-		}
-		SplitSegment2Lines(x, y, (int)segment.size(), segmentNumber);
-	}
+	SplitSegments(segmentPoints, ws);
 
 	/*----------- JOIN COLLINEAR LINES ----------------*/
 	JoinCollinearLines();
@@ -55,9 +43,9 @@ EDLines::EDLines(Mat srcImage ,  double _line_error, int _min_line_len, double _
 	double logNT = 2.0*(log10((double)width) + log10((double)height));
 
 	int lutSize = (width + height) / 8;
-	nfa = new NFALUT(lutSize, prob, logNT); // create look up table
+	nfa = NFALUT::get(lutSize, prob, logNT); // shared look up table
 	
-	ValidateLineSegments();
+	ValidateLineSegments(ws);
 
 	// Delete redundant space from lines
 	// Pop them back
@@ -72,49 +60,156 @@ EDLines::EDLines(Mat srcImage ,  double _line_error, int _min_line_len, double _
 		linePoints.push_back(LS(start, end));
 	} //end-for
 
-	delete[] x;
-	delete[] y;
-	delete nfa;
 }
 
 
-EDLines::EDLines(ED obj, double _line_error, int _min_line_len, double _max_distance_between_two_lines, double _max_error)
-	:ED(obj) 
+// Lines inside the given regions only (see EDRegions)
+EDLines::EDLines(Mat srcImage, const EDRegions &regions, double _line_error, int _min_line_len, double _max_distance_between_two_lines, double _max_error, bool _quantizedAngles)
+	:EDLines(ED(srcImage, regions, SOBEL_OPERATOR, 36, 8), _line_error, _min_line_len, _max_distance_between_two_lines, _max_error, _quantizedAngles)
+{
+}
+
+// Splits segments[first ... last-1] (EDSegments or EDChainCodes) into lines, appended to segmentLines
+template <class Segments>
+void EDLines::SplitSegments(const Segments &segments, int first, int last, EDWorkspace *ws, vector<LineSegment> &segmentLines)
+{
+	int bufferSize = 1;
+	for (int segmentNumber = first; segmentNumber < last; segmentNumber++) bufferSize = MAX(bufferSize, (int)segments[segmentNumber].size());
+
+	// Temporary buffers used during line fitting
+	double *x = ws->getPointX(bufferSize);
+	double *y = ws->getPointY(bufferSize);
+
+	for (int segmentNumber = first; segmentNumber < last; segmentNumber++) {
+		int k = 0;
+		for (Point p : segments[segmentNumber]) {
+			x[k] = p.x;
+			y[k] = p.y;
+			k++;
+		}
+		SplitSegment2Lines(x, y, k, segmentNumber, segmentLines, min_line_len, line_error, true);
+	}
+}
+
+// Splits every segment into lines. With a thread pool, chunks of consecutive segments of about the same
+// number of pixels are split in parallel, each into its own lines, which are then listed in segment order.
+template <class Segments>
+void EDLines::SplitSegments(const Segments &segments, EDWorkspace *ws)
+{
+	int noSegments = segments.size();
+	int noTasks = threadPool ? MIN(threadPool->get_workers_num(), noSegments / 32) : 1;
+
+	if (noTasks <= 1)
+		SplitSegments(segments, 0, noSegments, ws, lines);
+	else {
+		int totalPixels = 0;
+		for (int i = 0; i < noSegments; i++) totalPixels += segments[i].size();
+
+		vector<int> chunkStart(noTasks + 1, noSegments);
+		chunkStart[0] = 0;
+		for (int i = 0, t = 1, pixels = 0; i < noSegments && t < noTasks; i++) {
+			pixels += segments[i].size();
+			if ((long long)pixels*noTasks >= (long long)totalPixels*t) chunkStart[t++] = i + 1;
+		} //end-for
+
+		EDWorkspace *taskWorkspaces = ws->getTileWorkspaces(noTasks);
+		vector<vector<LineSegment>> chunkLines(noTasks);
+		vector<std::future<void>> results;
+		for (int t = 0; t < noTasks; t++)
+			results.push_back(threadPool->enqueue([this, &segments, &chunkStart, &chunkLines, taskWorkspaces, t] {
+				SplitSegments(segments, chunkStart[t], chunkStart[t + 1], &taskWorkspaces[t], chunkLines[t]);
+			}));
+		WaitForTasks(results);
+
+		for (int t = 0; t < noTasks; t++) lines.insert(lines.end(), chunkLines[t].begin(), chunkLines[t].end());
+	} //end-else
+
+	linesNo = (int)lines.size();
+}
+
+EDLines::EDLines(ED obj, double _line_error, int _min_line_len, double _max_distance_between_two_lines, double _max_error, bool _quantizedAngles)
+	:ED(std::move(obj)) 
 {
+	ConvertTo8Bit(); // validation works on 8-bit pixels
+
 	min_line_len = _min_line_len;
 	line_error = _line_error;
 	max_distance_between_two_lines = _max_distance_between_two_lines;
 	max_error = _max_error;
+	quantizedAngles = _quantizedAngles;
+	angleMap = NULL;
 
 	if (min_line_len == -1) // If no initial value given, compute it 
-		min_line_len = ComputeMinLineLength();
+		min_line_len = ComputeMinLineLength(width, height);
 
 	if (min_line_len < 9) // avoids small line segments in the result. Might be deleted!
 		min_line_len = 9;
 
 	
 
-	// Temporary buffers used during line fitting
-	size_t buffer_size = (width + height) * 8;
-	for (int segmentNumber = 0; segmentNumber < segmentPoints.size(); segmentNumber++) {
-		auto segment_size = segmentPoints[segmentNumber].size();
-		buffer_size = std::max(buffer_size, segment_size);
-	}
-	double* x = new double[buffer_size];
-	double* y = new double[buffer_size];
+	// Segments delivered as chain codes only (see EDDetector::setChainCodeOutput) are walked without expanding them
+	bool fromCodes = segmentPoints.empty() && !chainCodes.empty();
 
-	linesNo = 0;
+	EDWorkspace localWorkspace; // used only if no workspace is attached
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
 
 	// Use the whole segment
-	for (int segmentNumber = 0; segmentNumber < segmentPoints.size(); segmentNumber++) {
-		int k = 0;
-		std::vector<Point> segment = segmentPoints[segmentNumber];
-		for (int k = 0; k < segment.size(); k++) {
-			x[k] = segment[k].x;
-			y[k] = segment[k].y;
-		}
-		SplitSegment2Lines(x, y, (int)segment.size(), segmentNumber);
-	}
+	if (fromCodes)
+		SplitSegments(chainCodes, ws);
+	else
+		SplitSegments(segmentPoints, ws);
+
+	/*----------- JOIN COLLINEAR LINES ----------------*/
+	JoinCollinearLines();
+
+	/*----------- VALIDATE LINES ----------------*/
+#define PRECISON_ANGLE 22.5 
+	prec = (PRECISON_ANGLE / 180)*M_PI;
+	double prob = 0.125;
+#undef PRECISON_ANGLE
+
+	double logNT = 2.0*(log10((double)width) + log10((double)height));
+
+	int lutSize = (width + height) / 8;
+	nfa = NFALUT::get(lutSize, prob, logNT); // shared look up table
+
+	ValidateLineSegments(ws);
+
+	// Delete redundant space from lines
+	// Pop them back
+	int size = (int)lines.size();
+	for (int i = 1; i <= size - linesNo; i++)
+		lines.pop_back();
+
+
+	for (int i = 0; i<linesNo; i++) {
+		Point2d start(lines[i].sx, lines[i].sy);
+		Point2d end(lines[i].ex, lines[i].ey);
+
+		linePoints.push_back(LS(start, end));
+	} //end-for
+
+}
+
+EDLines::EDLines(ED obj, EDLineSplitSink &splitSink, double _max_distance_between_two_lines, double _max_error, bool _quantizedAngles)
+	:ED(std::move(obj))
+{
+	CV_Assert(splitSink.getImageSize() == Size(width, height));
+	ConvertTo8Bit(); // validation works on 8-bit pixels
+
+	min_line_len = splitSink.getMinLineLength();
+	line_error = splitSink.getLineError();
+	max_distance_between_two_lines = _max_distance_between_two_lines;
+	max_error = _max_error;
+	quantizedAngles = _quantizedAngles;
+	angleMap = NULL;
+
+	EDWorkspace localWorkspace; // used only if no workspace is attached
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
+
+	// The segments were split by the sink during linking
+	lines = splitSink.getLines();
+	linesNo = (int)lines.size();
 
 	/*----------- JOIN COLLINEAR LINES ----------------*/
 	JoinCollinearLines();
@@ -128,9 +223,9 @@ EDLines::EDLines(ED obj, double _line_error, int _min_line_len, double _max_dist
 	double logNT = 2.0*(log10((double)width) + log10((double)height));
 
 	int lutSize = (width + height) / 8;
-	nfa = new NFALUT(lutSize, prob, logNT); // create look up table
+	nfa = NFALUT::get(lutSize, prob, logNT); // shared look up table
 
-	ValidateLineSegments();
+	ValidateLineSegments(ws);
 
 	// Delete redundant space from lines
 	// Pop them back
@@ -146,9 +241,6 @@ EDLines::EDLines(ED obj, double _line_error, int _min_line_len, double _max_dist
 		linePoints.push_back(LS(start, end));
 	} //end-for
 
-	delete[] x;
-	delete[] y;
-	delete nfa;
 }
 
 EDLines::EDLines(EDColor obj, double _line_error, int _min_line_len, double _max_distance_between_two_lines, double _max_error)
@@ -158,35 +250,21 @@ EDLines::EDLines(EDColor obj, double _line_error, int _min_line_len, double _max
 	line_error = _line_error;
 	max_distance_between_two_lines = _max_distance_between_two_lines;
 	max_error = _max_error;
+	quantizedAngles = false;
+	angleMap = NULL;
 
 	if (min_line_len == -1) // If no initial value given, compute it 
-		min_line_len = ComputeMinLineLength();
+		min_line_len = ComputeMinLineLength(width, height);
 
 	if (min_line_len < 9) // avoids small line segments in the result. Might be deleted!
 		min_line_len = 9;
 
 
-	// Temporary buffers used during line fitting
-	size_t buffer_size = (width + height) * 8;
-	for (int segmentNumber = 0; segmentNumber < segmentPoints.size(); segmentNumber++) {
-		auto segment_size = segmentPoints[segmentNumber].size();
-		buffer_size = std::max(buffer_size, segment_size);
-	}
-	double* x = new double[buffer_size];
-	double* y = new double[buffer_size];
-
-	linesNo = 0;
+	EDWorkspace localWorkspace; // used only if no workspace is attached
+	EDWorkspace *ws = workspace ? workspace : &localWorkspace;
 
 	// Use the whole segment
-	for (int segmentNumber = 0; segmentNumber < segmentPoints.size(); segmentNumber++) {
-		int k = 0;
-		std::vector<Point> segment = segmentPoints[segmentNumber];
-		for (int k = 0; k < segment.size(); k++) {
-			x[k] = segment[k].x;
-			y[k] = segment[k].y;
-		}
-		SplitSegment2Lines(x, y, (int)segment.size(), segmentNumber);
-	}
+	SplitSegments(segmentPoints, ws);
 
 	/*----------- JOIN COLLINEAR LINES ----------------*/
 	JoinCollinearLines();
@@ -200,7 +278,7 @@ EDLines::EDLines(EDColor obj, double _line_error, int _min_line_len, double _max
 	double logNT = 2.0*(log10((double)width) + log10((double)height));
 
 	int lutSize = (width + height) / 8;
-	nfa = new NFALUT(lutSize, prob, logNT); // create look up table
+	nfa = NFALUT::get(lutSize, prob, logNT); // shared look up table
 
 	// Since edge segments are validated in ed color, 
 	// Validation is not performed again in line segment detection  
@@ -221,14 +299,12 @@ EDLines::EDLines(EDColor obj, double _line_error, int _min_line_len, double _max
 		linePoints.push_back(LS(start, end));
 	} //end-for
 
-	delete[] x;
-	delete[] y;
-	delete nfa;
 }
 
 EDLines::EDLines()
 {
-	//
+	quantizedAngles = false;
+	angleMap = NULL;
 }
 
 vector<LS> EDLines::getLines()
@@ -241,6 +317,224 @@ int EDLines::getLinesNo()
 	return linesNo;
 }
 
+int EDLines::joinLinesAcrossSegments()
+{
+	int n = linesNo;
+	if (n < 2) return 0;
+
+	// End points of a join are at most max_distance_between_two_lines apart: in the same or a neighbouring cell
+	int cellSize = MAX(1, (int)ceil(max_distance_between_two_lines));
+	int gridWidth = width / cellSize + 1;
+	int gridHeight = height / cellSize + 1;
+	vector<vector<int>> grid(gridWidth*gridHeight);
+
+	auto cellX = [&](double x) { return MIN(MAX((int)floor(x / cellSize), 0), gridWidth - 1); };
+	auto cellY = [&](double y) { return MIN(MAX((int)floor(y / cellSize), 0), gridHeight - 1); };
+
+	// Lists a line in the cells of its end points. Entries of end points that moved are left behind;
+	// they only bring in candidates that fail the distance test.
+	auto insert = [&](int i) {
+		int c1 = cellY(lines[i].sy)*gridWidth + cellX(lines[i].sx);
+		int c2 = cellY(lines[i].ey)*gridWidth + cellX(lines[i].ex);
+		grid[c1].push_back(i);
+		if (c2 != c1) grid[c2].push_back(i);
+	};
+
+	for (int i = 0; i < n; i++) insert(i);
+
+	vector<char> alive(n, 1);
+	vector<int> listed(n, -1); // last query a line was listed in
+	vector<int> candidates;
+	int query = 0;
+	int noJoins = 0;
+
+	// Every line absorbs the lines it can join, nearest index first, until there are none left
+	for (int i = 0; i < n; i++) {
+		if (!alive[i]) continue;
+
+		bool joined = true;
+		while (joined) {
+			joined = false;
+
+			candidates.clear();
+			query++;
+			for (int e = 0; e < 2; e++) {
+				int cx = cellX(e ? lines[i].ex : lines[i].sx);
+				int cy = cellY(e ? lines[i].ey : lines[i].sy);
+
+				for (int y = MAX(cy - 1, 0); y <= MIN(cy + 1, gridHeight - 1); y++)
+					for (int x = MAX(cx - 1, 0); x <= MIN(cx + 1, gridWidth - 1); x++)
+						for (int j : grid[y*gridWidth + x]) {
+							if (j == i || !alive[j] || listed[j] == query) continue;
+							listed[j] = query;
+							candidates.push_back(j);
+						} //end-for
+			} //end-for
+
+			std::sort(candidates.begin(), candidates.end());
+			for (int j : candidates) {
+				if (!MayJoin(lines[i], lines[j])) continue;
+				if (TryToJoinTwoLineSegments(&lines[i], &lines[j], i)) {
+					alive[j] = 0;
+					insert(i);
+					noJoins++;
+					joined = true;
+					break;
+				} //end-if
+			} //end-for
+		} //end-while
+	} //end-for
+
+	int noLines = 0;
+	for (int i = 0; i < n; i++)
+		if (alive[i]) lines[noLines++] = lines[i];
+
+	lines.erase(lines.begin() + noLines, lines.end());
+	linesNo = noLines;
+
+	linePoints.clear();
+	for (int i = 0; i<linesNo; i++) linePoints.push_back(LS(Point2d(lines[i].sx, lines[i].sy), Point2d(lines[i].ex, lines[i].ey)));
+
+	return noJoins;
+}
+
+int EDLines::refineLinesSubPixel(double searchRange)
+{
+	if (linesNo == 0) return 0;
+
+	// Profiles are sampled from the smoothed frame. If ED did not keep all of it, it is smoothed again here
+	// (into a new image: smoothImage may be shared with the detector)
+	Mat smooth;
+	if (smoothedInFull && !smoothImage.empty())
+		smooth = smoothImage;
+	else if (!srcImage.empty()) {
+		if (sigma == 1.0)
+			GaussianBlur(srcImage, smooth, Size(5, 5), sigma);
+		else
+			GaussianBlur(srcImage, smooth, Size(), sigma); // calculate kernel from sigma
+	}
+	else
+		return 0;
+
+	const uchar *img = smooth.data;
+	int range = MAX(1, (int)ceil(searchRange));
+	int noTasks = threadPool ? MIN(threadPool->get_workers_num(), linesNo / 64) : 1;
+
+	int noRefined = 0;
+	if (noTasks <= 1)
+		noRefined = RefineLines(0, linesNo, range, img);
+	else {
+		vector<int> taskRefined(noTasks, 0);
+		vector<std::future<void>> results;
+		for (int t = 0; t < noTasks; t++)
+			results.push_back(threadPool->enqueue([this, range, img, noTasks, t, &taskRefined] {
+				taskRefined[t] = RefineLines(linesNo*t / noTasks, linesNo*(t + 1) / noTasks, range, img);
+			}));
+		WaitForTasks(results);
+
+		for (int t = 0; t < noTasks; t++) noRefined += taskRefined[t];
+	} //end-else
+
+	linePoints.clear();
+	for (int i = 0; i<linesNo; i++) linePoints.push_back(LS(Point2d(lines[i].sx, lines[i].sy), Point2d(lines[i].ex, lines[i].ey)));
+
+	return noRefined;
+}
+
+//-----------------------------------------------------------------------------------------
+// Refines lines[first ... last-1] (see refineLinesSubPixel); returns the number of lines refined.
+// The profiles of a line are laid out in flat arrays & sampled in one loop, which the compiler vectorizes.
+//
+int EDLines::RefineLines(int first, int last, int range, const uchar *img)
+{
+	int P = 2 * range + 3; // samples per profile, at offsets -range-1 ... range+1 across the line
+	vector<float> qx, qy, val; // sample positions & intensities of all profiles of a line
+	vector<float> grad(P);
+	vector<double> px, py; // sub-pixel edge points
+	int noRefined = 0;
+
+	for (int i = first; i < last; i++) {
+		LineSegment *ls = &lines[i];
+		double dx = ls->ex - ls->sx, dy = ls->ey - ls->sy;
+		double len = sqrt(dx*dx + dy*dy);
+		if (len < 2) continue;
+
+		double ux = dx / len, uy = dy / len; // along the line
+		double nx = -uy, ny = ux;            // across the line
+
+		// One profile per pixel along the line, if it lies inside the image (bilinear sampling reads one pixel right & down)
+		int T = (int)len;
+		qx.resize((T + 1)*P); qy.resize((T + 1)*P); val.resize((T + 1)*P);
+		int noProfiles = 0;
+		for (int t = 0; t <= T; t++) {
+			double x0 = ls->sx + ux*t - nx*(range + 1), y0 = ls->sy + uy*t - ny*(range + 1);
+			double x1 = x0 + nx*(P - 1), y1 = y0 + ny*(P - 1);
+			if (MIN(x0, x1) < 0 || MIN(y0, y1) < 0 || MAX(x0, x1) >= width - 1 || MAX(y0, y1) >= height - 1) continue;
+
+			float *sx = &qx[noProfiles*P], *sy = &qy[noProfiles*P];
+			for (int j = 0; j < P; j++) { sx[j] = (float)(x0 + nx*j); sy[j] = (float)(y0 + ny*j); }
+			noProfiles++;
+		} //end-for
+
+		if (2 * noProfiles < T + 1) continue;
+
+		int noSamples = noProfiles*P;
+		for (int s = 0; s < noSamples; s++) {
+			int x = (int)qx[s], y = (int)qy[s];
+			float fx = qx[s] - x, fy = qy[s] - y;
+			const uchar *p = img + y*width + x;
+			float top = p[0] + fx*(p[1] - p[0]);
+			float bottom = p[width] + fx*(p[width + 1] - p[width]);
+			val[s] = top + fy*(bottom - top);
+		} //end-for
+
+		// Peak of the gradient magnitude (central differences) of every profile, refined by a parabola
+		px.clear(); py.clear();
+		for (int k = 0; k < noProfiles; k++) {
+			const float *v = &val[k*P];
+			for (int j = 1; j < P - 1; j++) grad[j] = fabs(v[j + 1] - v[j - 1]);
+
+			int peak = 1;
+			for (int j = 2; j < P - 1; j++) if (grad[j] > grad[peak]) peak = j;
+			if (peak == 1 || peak == P - 2) continue; // no maximum inside the search range
+
+			double denom = grad[peak - 1] - 2 * grad[peak] + grad[peak + 1];
+			if (denom >= 0) continue;
+
+			double offset = peak - (range + 1) + 0.5*(grad[peak - 1] - grad[peak + 1]) / denom;
+			px.push_back(qx[k*P + range + 1] + nx*offset);
+			py.push_back(qy[k*P + range + 1] + ny*offset);
+		} //end-for
+
+		int n = (int)px.size();
+		if (2 * n < T + 1 || n < 2) continue;
+
+		// Orthogonal regression through the peaks
+		double mx = 0, my = 0;
+		for (int k = 0; k < n; k++) { mx += px[k]; my += py[k]; }
+		mx /= n; my /= n;
+
+		double Sxx = 0, Sxy = 0, Syy = 0;
+		for (int k = 0; k < n; k++) {
+			double x = px[k] - mx, y = py[k] - my;
+			Sxx += x*x; Sxy += x*y; Syy += y*y;
+		} //end-for
+
+		double theta = 0.5*atan2(2 * Sxy, Sxx - Syy);
+		double cx = cos(theta), cy = sin(theta);
+
+		double ts = (ls->sx - mx)*cx + (ls->sy - my)*cy;
+		double te = (ls->ex - mx)*cx + (ls->ey - my)*cy;
+		ls->sx = mx + ts*cx; ls->sy = my + ts*cy;
+		ls->ex = mx + te*cx; ls->ey = my + te*cy;
+		UpdateLineParameters(ls);
+
+		noRefined++;
+	} //end-for
+
+	return noRefined;
+}
+
 Mat EDLines::getLineImage()
 {
 	Mat lineImage = Mat(height, width, CV_8UC1, Scalar(255));
@@ -264,7 +558,7 @@ Mat EDLines::drawOnImage()
 
 //-----------------------------------------------------------------------------------------
 // Computes the minimum line length using the NFA formula given width & height values
-int EDLines::ComputeMinLineLength() {
+int EDLines::ComputeMinLineLength(int width, int height) {
 	// The reason we are dividing the theoretical minimum line length by 2 is because
 	// we now test short line segments by a line support region rectangle having width=2.
 	// This means that within a line support region rectangle for a line segment of length "l" 
@@ -278,32 +572,33 @@ int EDLines::ComputeMinLineLength() {
 //-----------------------------------------------------------------
 // Given a full segment of pixels, splits the chain to lines
 // This code is used when we use the whole segment of pixels
+// dropPointLines: a line whose end points coincide ends the current line without being added (as EDLines does)
 //
-void EDLines::SplitSegment2Lines(double * x, double * y, int noPixels, int segmentNo)
+void EDLines::SplitSegment2Lines(double * x, double * y, int noPixels, int segmentNo, vector<LineSegment> &lines, int min_line_len, double line_error, bool dropPointLines)
 {
-
 	// First pixel of the line segment within the segment of points
 	int firstPixelIndex = 0;
 
 	while (noPixels >= min_line_len) {
 		// Start by fitting a line to MIN_LINE_LEN pixels
 		bool valid = false;
-		double lastA, lastB, error;
+		double lastA, lastB;
 		int lastInvert;
 
+		// Sums over the pixels of the current fit, x[0 ... len-1]: the window slides and the line grows in O(1) per pixel
+		LineFitSums sums;
+		for (int k = 0; k < min_line_len; k++) sums.add(x[k], y[k]);
+
 		while (noPixels >= min_line_len) {
-			LineFit(x, y, min_line_len, lastA, lastB, error, lastInvert);
-			if (error <= 0.5) { valid = true; break; }
+			if (FitsLine(x, y, sums, 0.5, lastA, lastB, lastInvert)) { valid = true; break; }
+
+			// Go slowly
+			sums.remove(x[0], y[0]);
+			if (noPixels > min_line_len) sums.add(x[min_line_len], y[min_line_len]);
 
-#if 1
-			noPixels -= 1;   // Go slowly
+			noPixels -= 1;
 			x += 1; y += 1;
 			firstPixelIndex += 1;
-#else
-			noPixels -= 2;   // Go faster (for speed)
-			x += 2; y += 2;
-			firstPixelIndex += 2;
-#endif
 		} //end-while
 
 		if (valid == false) return;
@@ -335,8 +630,9 @@ void EDLines::SplitSegment2Lines(double * x, double * y, int noPixels, int segme
 			} //end-while
 
 			if (goodPixelCount >= 2) {
+				for (int k = len; k <= lastGoodIndex; k++) sums.add(x[k], y[k]);
 				len += lastGoodIndex - startIndex + 1;
-				LineFit(x, y, len, lastA, lastB, lastInvert);  // faster LineFit
+				LineFit(sums, lastA, lastB, lastInvert);  // faster LineFit
 				index = lastGoodIndex + 1;
 			} // end-if
 
@@ -353,12 +649,11 @@ void EDLines::SplitSegment2Lines(double * x, double * y, int noPixels, int segme
 				while (ComputeMinDistance(x[index], y[index], lastA, lastB, lastInvert) > line_error) index--;
 				ComputeClosestPoint(x[index], y[index], lastA, lastB, lastInvert, ex, ey);
 
-				if ((sx == ex) & (sy == ey))
+				if (dropPointLines && (sx == ex) & (sy == ey))
 					break;
 
 				// Add the line segment to lines
 				lines.push_back(LineSegment(lastA, lastB, lastInvert, sx, sy, ex, ey, segmentNo, firstPixelIndex + noSkippedPixels, index - noSkippedPixels + 1));
-				linesNo++;
 				len = index + 1;
 				break;
 			} //end-else
@@ -417,106 +712,144 @@ void EDLines::JoinCollinearLines()
 	linesNo = lastLineIndex + 1;
 }
 
-void EDLines::ValidateLineSegments()
+// Validates lines[0 ... linesNo-1]; with a thread pool, chunks of lines are validated in parallel, each with
+// its own buffers. Valid lines are then compacted in order & the others moved to invalidLines.
+void EDLines::ValidateLineSegments(EDWorkspace *ws)
 {
+	if (quantizedAngles) ComputeAngleMap();
+
+	vector<char> valid(linesNo);
+	int noTasks = threadPool ? MIN(threadPool->get_workers_num(), linesNo / 64) : 1;
 
-	int *x = new int[(width + height) * 4];
-	int *y = new int[(width + height) * 4];
+	if (noTasks <= 1)
+		ValidateLineSegments(0, linesNo, ws, valid.data());
+	else {
+		EDWorkspace *taskWorkspaces = ws->getTileWorkspaces(noTasks);
+		vector<std::future<void>> results;
+		for (int t = 0; t < noTasks; t++)
+			results.push_back(threadPool->enqueue([this, &valid, taskWorkspaces, noTasks, t] {
+				ValidateLineSegments(linesNo*t / noTasks, linesNo*(t + 1) / noTasks, &taskWorkspaces[t], valid.data());
+			}));
+		WaitForTasks(results);
+	} //end-else
 
 	int noValidLines = 0;
-	int eraseOffset = 0;
 	for (int i = 0; i< linesNo; i++) {
-		LineSegment *ls = &lines[i];
-
-		// Compute Line's angle
-		double lineAngle;
-
-		if (ls->invert == 0) {
-			// y = a + bx
-			lineAngle = atan(ls->b);
-
+		if (valid[i]) {
+			if (i != noValidLines) lines[noValidLines] = lines[i];
+			noValidLines++;
 		}
 		else {
-			// x = a + by
-			lineAngle = atan(1.0 / ls->b);
+			invalidLines.push_back(lines[i]);
 		} //end-else
+	} //end-for
 
-		if (lineAngle < 0) lineAngle += M_PI;
+	linesNo = noValidLines;
+}
 
-		Point *pixels = &(segmentPoints[ls->segmentNo][0]);
-		int noPixels = ls->len;
+// Sets valid[i] for lines[first ... last-1]; lines are not changed
+void EDLines::ValidateLineSegments(int first, int last, EDWorkspace *ws, char *valid)
+{
+	int *x = ws->getRectX((width + height) * 4);
+	int *y = ws->getRectY((width + height) * 4);
+	vector<Point> codedPixels;
 
-		bool valid = false;
+	for (int i = first; i < last; i++) valid[i] = ValidateLineSegment(&lines[i], x, y, codedPixels);
+}
 
-		// Accept very long lines without testing. They are almost never invalidated.
-		if (ls->len >= 80) {
-			valid = true;
+// NFA test of a single line; x & y are the rectangle buffers of ValidateLineSegmentRect,
+// codedPixels holds the decoded pixels if the segments are chain coded
+bool EDLines::ValidateLineSegment(LineSegment *ls, int *x, int *y, vector<Point> &codedPixels)
+{
+	bool fromCodes = segmentPoints.empty() && !chainCodes.empty(); // chain code output only
 
-			// Validate short line segments by a line support region rectangle having width=2
-		}
-		else if (ls->len <= 25) {
-			valid = ValidateLineSegmentRect( x, y, ls);
+	// Compute Line's angle
+	double lineAngle;
 
-		}
-		else {
-			// Longer line segments are first validated by a line support region rectangle having width=1 (for speed)
-			// If the line segment is still invalid, then a line support region rectangle having width=2 is tried
-			// If the line segment fails both tests, it is discarded
-			int aligned = 0;
-			int count = 0;
-			for (int j = 0; j<noPixels; j++) {
-				int r = pixels[j].x;
-				int c = pixels[j].y;
-
-				if (r <= 0 || r >= height - 1 || c <= 0 || c >= width - 1) continue;
-
-				count++;
-
-				// compute gx & gy using the simple [-1 -1 -1]
-				//                                  [ 1  1  1]  filter in both directions
-				// Faster method below
-				// A B C
-				// D x E
-				// F G H
-				// gx = (C-A) + (E-D) + (H-F)
-				// gy = (F-A) + (G-B) + (H-C)
-				//
-				// To make this faster: 
-				// com1 = (H-A)
-				// com2 = (C-F)
-				// Then: gx = com1 + com2 + (E-D) = (H-A) + (C-F) + (E-D) = (C-A) + (E-D) + (H-F)
-				//       gy = com2 - com1 + (G-B) = (H-A) - (C-F) + (G-B) = (F-A) + (G-B) + (H-C)
-				// 
-				int com1 = srcImg[(r + 1)*width + c + 1] - srcImg[(r - 1)*width + c - 1];
-				int com2 = srcImg[(r - 1)*width + c + 1] - srcImg[(r + 1)*width + c - 1];
-
-				int gx = com1 + com2 + srcImg[r*width + c + 1] - srcImg[r*width + c - 1];
-				int gy = com1 - com2 + srcImg[(r + 1)*width + c] - srcImg[(r - 1)*width + c];
-				
-				double pixelAngle = nfa->myAtan2((double)gx, (double)-gy);
-				double diff = fabs(lineAngle - pixelAngle);
+	if (ls->invert == 0) {
+		// y = a + bx
+		lineAngle = atan(ls->b);
 
-				if (diff <= prec || diff >= M_PI - prec) aligned++;
-			} //end-for
+	}
+	else {
+		// x = a + by
+		lineAngle = atan(1.0 / ls->b);
+	} //end-else
 
-			// Check validation by NFA computation (fast due to LUT)
-			valid = nfa->checkValidationByNFA(count, aligned);
-			if (valid == false) valid = ValidateLineSegmentRect(x, y, ls);
-		} //end-else
+	if (lineAngle < 0) lineAngle += M_PI;
 
-		if (valid) {
-			if (i != noValidLines) lines[noValidLines] = lines[i];
-			noValidLines++;
-		}
-		else {
-			invalidLines.push_back(lines[i]);
-		} //end-else
-	} //end-for
+	uchar alignedBins[256];
+	if (angleMap) AlignedBins(lineAngle, alignedBins);
 
-	linesNo = noValidLines;
+	const Point *pixels = fromCodes ? NULL : segmentPoints[ls->segmentNo].pixels;
+	int noPixels = ls->len;
+
+	bool valid = false;
+
+	// Accept very long lines without testing. They are almost never invalidated.
+	if (ls->len >= 80) {
+		valid = true;
+
+		// Validate short line segments by a line support region rectangle having width=2
+	}
+	else if (ls->len <= 25) {
+		valid = ValidateLineSegmentRect( x, y, ls);
+
+	}
+	else {
+		// Longer line segments are first validated by a line support region rectangle having width=1 (for speed)
+		// If the line segment is still invalid, then a line support region rectangle having width=2 is tried
+		// If the line segment fails both tests, it is discarded
+		int aligned = 0;
+		int count = 0;
+		if (fromCodes) {
+			codedPixels.resize(noPixels);
+			chainCodes[ls->segmentNo].decode(codedPixels.data(), noPixels);
+			pixels = codedPixels.data();
+		} //end-if
+		for (int j = 0; j<noPixels; j++) {
+			int r = pixels[j].x;
+			int c = pixels[j].y;
+
+			if (r <= 0 || r >= height - 1 || c <= 0 || c >= width - 1) continue;
+
+			count++;
+
+			if (angleMap) { aligned += alignedBins[angleMap[r*width + c]]; continue; }
+
+			// compute gx & gy using the simple [-1 -1 -1]
+			//                                  [ 1  1  1]  filter in both directions
+			// Faster method below
+			// A B C
+			// D x E
+			// F G H
+			// gx = (C-A) + (E-D) + (H-F)
+			// gy = (F-A) + (G-B) + (H-C)
+			//
+			// To make this faster: 
+			// com1 = (H-A)
+			// com2 = (C-F)
+			// Then: gx = com1 + com2 + (E-D) = (H-A) + (C-F) + (E-D) = (C-A) + (E-D) + (H-F)
+			//       gy = com2 - com1 + (G-B) = (H-A) - (C-F) + (G-B) = (F-A) + (G-B) + (H-C)
+			// 
+			int com1 = srcImg[(r + 1)*width + c + 1] - srcImg[(r - 1)*width + c - 1];
+			int com2 = srcImg[(r - 1)*width + c + 1] - srcImg[(r + 1)*width + c - 1];
+
+			int gx = com1 + com2 + srcImg[r*width + c + 1] - srcImg[r*width + c - 1];
+			int gy = com1 - com2 + srcImg[(r + 1)*width + c] - srcImg[(r - 1)*width + c];
+			
+			double pixelAngle = nfa->myAtan2((double)gx, (double)-gy);
+			double diff = fabs(lineAngle - pixelAngle);
+
+			if (diff <= prec || diff >= M_PI - prec) aligned++;
+		} //end-for
+
+		// Check validation by NFA computation (fast due to LUT)
+		valid = nfa->checkValidationByNFA(count, aligned);
+		if (valid == false) valid = ValidateLineSegmentRect(x, y, ls);
+	} //end-else
 
-	delete x;
-	delete y;
+	return valid;
 }
 
 bool EDLines::ValidateLineSegmentRect(int * x, int * y, LineSegment * ls)
@@ -537,6 +870,9 @@ bool EDLines::ValidateLineSegmentRect(int * x, int * y, LineSegment * ls)
 
 	if (lineAngle < 0) lineAngle += M_PI;
 
+	uchar alignedBins[256];
+	if (angleMap) AlignedBins(lineAngle, alignedBins);
+
 	int noPoints = 0;
 
 	// Enumerate all pixels that fall within the bounding rectangle
@@ -553,6 +889,8 @@ bool EDLines::ValidateLineSegmentRect(int * x, int * y, LineSegment * ls)
 
 		count++;
 
+		if (angleMap) { aligned += alignedBins[angleMap[r*width + c]]; continue; }
+
 		// compute gx & gy using the simple [-1 -1 -1]
 		//                                  [ 1  1  1]  filter in both directions
 		// Faster method below
@@ -585,6 +923,70 @@ bool EDLines::ValidateLineSegmentRect(int * x, int * y, LineSegment * ls)
 
 
 
+//-----------------------------------------------------------------------------------
+// Gradient angle of every inner pixel of srcImg as validation computes it, NFALUT::myAtan2(gx, -gy) in [0, PI],
+// quantized to 256 bins: bin b holds angles in [b, b+1)*PI/256 (PI itself falls into bin 0).
+// myAtan2 looks the angle up by the ratio of the smaller to the larger gradient component, index
+// 1024*min/max, and places it by the signs & which component is larger; the bins of all those cases are
+// tabulated once, so every pixel costs an integer division & a table lookup.
+//
+void EDLines::ComputeAngleMap()
+{
+	static const int RATIO_STEPS = 1024; // MAX_LUT_SIZE of myAtan2
+
+	// bins[k][i]: k = 2*(signs of gx & -gy differ) + (|gx| > |gy|), i: ratio index
+	uchar bins[4][RATIO_STEPS + 1];
+	for (int i = 0; i <= RATIO_STEPS; i++) {
+		double angle = atan((double)i / RATIO_STEPS);
+		double angles[4] = { angle, M_PI / 2 - angle, M_PI - angle, M_PI / 2 + angle };
+		for (int k = 0; k < 4; k++) bins[k][i] = (uchar)((int)(angles[k] * (256 / M_PI)) & 255);
+	} //end-for
+
+	angleImage.create(height, width, CV_8UC1);
+	angleImage.setTo(Scalar(0));
+	angleMap = angleImage.data;
+
+	vector<int> gx(width), gy(width);
+	for (int r = 1; r < height - 1; r++) {
+		const uchar *above = srcImg + (r - 1)*width;
+		const uchar *row = srcImg + r*width;
+		const uchar *below = srcImg + (r + 1)*width;
+
+		// Gradients of the whole row first (the compiler vectorizes this loop), see ValidateLineSegmentRect
+		for (int c = 1; c < width - 1; c++) {
+			int com1 = below[c + 1] - above[c - 1];
+			int com2 = above[c + 1] - below[c - 1];
+
+			gx[c] = com1 + com2 + row[c + 1] - row[c - 1];
+			gy[c] = com1 - com2 + below[c] - above[c];
+		} //end-for
+
+		uchar *angles = angleMap + r*width;
+		for (int c = 1; c < width - 1; c++) {
+			// myAtan2(yy = gx, xx = -gy)
+			int yy = gx[c], xx = -gy[c];
+			int ay = abs(yy), ax = abs(xx);
+			int invert = ay > ax;
+			int mn = invert ? ax : ay, mx = invert ? ay : ax;
+			int ratio = mx ? mn*RATIO_STEPS / mx : 0; // = (int)(ratio*MAX_LUT_SIZE) of myAtan2
+			int differ = (xx >= 0) != (yy >= 0);
+
+			angles[c] = bins[2 * differ + invert][ratio];
+		} //end-for
+	} //end-for
+}
+
+//-----------------------------------------------------------------------------------
+// aligned[b] = 1 if the angles of bin b (see ComputeAngleMap) are aligned with lineAngle up to prec, judged at the bin centre
+//
+void EDLines::AlignedBins(double lineAngle, uchar *aligned)
+{
+	for (int b = 0; b < 256; b++) {
+		double diff = fabs(lineAngle - (b + 0.5)*(M_PI / 256));
+		aligned[b] = diff <= prec || diff >= M_PI - prec;
+	} //end-for
+}
+
 double EDLines::ComputeMinDistance(double x1, double y1, double a, double b, int invert)
 {
 	double x2, y2;
@@ -782,6 +1184,60 @@ void EDLines::LineFit(double * x, double * y, int count, double &a, double &b, d
 	} //end-else
 }
 
+//-----------------------------------------------------------------------------------
+// Same fit as LineFit(x, y, count, a, b, invert) over the pixels summed up in sums
+//
+void EDLines::LineFit(const LineFitSums &sums, double &a, double &b, int invert)
+{
+	if (sums.S<2) return;
+
+	double S = sums.S, Sx = sums.Sx, Sy = sums.Sy, Sxx = sums.Sxx, Sxy = sums.Sxy;
+	if (invert) {
+		// Vertical line. Swap x & y
+		Sx = sums.Sy;
+		Sy = sums.Sx;
+		Sxx = sums.Syy;
+	} //end-if
+
+	double D = S*Sxx - Sx*Sx;
+	a = (Sxx*Sy - Sx*Sxy) / D;
+	b = (S  *Sxy - Sx* Sy) / D;
+}
+
+//-----------------------------------------------------------------------------------
+// Fits a line to the pixels summed up in sums (x[0 ... sums.S-1]) and returns true if the fit error
+// of LineFit(x, y, count, a, b, e, invert) is at most maxError. The error comes from the sums in O(1);
+// only ties in the direction, lines with b == 0 (mean absolute error) & errors within rounding
+// of maxError are decided by the fit over the pixels, so the result is always that of LineFit.
+//
+bool EDLines::FitsLine(double * x, double * y, const LineFitSums &sums, double maxError, double &a, double &b, int &invert)
+{
+	int count = (int)sums.S;
+	if (count<2) return false;
+
+	// count * centered second moments; exact integers
+	double Cxx = sums.S*sums.Sxx - sums.Sx*sums.Sx;
+	double Cyy = sums.S*sums.Syy - sums.Sy*sums.Sy;
+	double Cxy = sums.S*sums.Sxy - sums.Sx*sums.Sy;
+
+	double e;
+	if (Cxx != Cyy) {
+		invert = Cxx < Cyy ? 1 : 0;
+		LineFit(sums, a, b, invert);
+
+		if (b != 0.0) {
+			// Sum of squared residuals along the fitted axis, then the perpendicular distance
+			double Cuu = invert ? Cyy : Cxx, Cvv = invert ? Cxx : Cyy;
+			double residual = MAX(0.0, (Cvv - Cxy*Cxy / Cuu) / sums.S);
+			e = sqrt(residual / (count*(1.0 + b*b)));
+			if (fabs(e - maxError) > 1e-9*(1.0 + maxError)) return e <= maxError;
+		} //end-if
+	} //end-if
+
+	LineFit(x, y, count, a, b, e, invert);
+	return e <= maxError;
+}
+
 //-----------------------------------------------------------------
 // Checks if the given line segments are collinear & joins them if they are
 // In case of a join, ls1 is updated. ls2 is NOT changed
@@ -940,6 +1396,23 @@ bool EDLines::TryToJoinTwoLineSegments(LineSegment * ls1, LineSegment * ls2, int
 	return true;
 }
 
+//-------------------------------------------------------------------------------
+// Cheap necessary condition for TryToJoinTwoLineSegments. The join needs the end points & the midpoint of the
+// shorter line within max_error of the longer line on average, so the end points of the shorter line (length l)
+// differ in distance from it by at most 3*max_error, i.e. l*sin(angle between the lines) <= 3*max_error.
+//
+bool EDLines::MayJoin(const LineSegment &ls1, const LineSegment &ls2)
+{
+	double dx1 = ls1.ex - ls1.sx, dy1 = ls1.ey - ls1.sy;
+	double dx2 = ls2.ex - ls2.sx, dy2 = ls2.ey - ls2.sy;
+	double len1 = sqrt(dx1*dx1 + dy1*dy1);
+	double len2 = sqrt(dx2*dx2 + dy2*dy2);
+
+	// |cross| = len1*len2*sin(angle): divided by the longer length, it is l*sin(angle)
+	double cross = fabs(dx1*dy2 - dy1*dx2);
+	return cross <= (3 * max_error + 1e-6)*MAX(len1, len2);
+}
+
 //-------------------------------------------------------------------------------
 // Computes the minimum distance between the end points of two lines
 //
@@ -1175,88 +1648,63 @@ void EDLines::EnumerateRectPoints(double sx, double sy, double ex, double ey, in
 
 void EDLines::SplitSegment2Lines(double * x, double * y, int noPixels, int segmentNo, vector<LineSegment> &lines, int min_line_len, double line_error)
 {
-	// First pixel of the line segment within the segment of points
-	int firstPixelIndex = 0;
-
-	while (noPixels >= min_line_len) {
-		// Start by fitting a line to MIN_LINE_LEN pixels
-		bool valid = false;
-		double lastA, lastB, error;
-		int lastInvert;
-
-		while (noPixels >= min_line_len) {
-			LineFit(x, y, min_line_len, lastA, lastB, error, lastInvert);
-			if (error <= 0.5) { valid = true; break; }
-
-#if 1
-			noPixels -= 1;   // Go slowly
-			x += 1; y += 1;
-			firstPixelIndex += 1;
-#else
-			noPixels -= 2;   // Go faster (for speed)
-			x += 2; y += 2;
-			firstPixelIndex += 2;
-#endif
-		} //end-while
-
-		if (valid == false) return;
+	SplitSegment2Lines(x, y, noPixels, segmentNo, lines, min_line_len, line_error, false);
+}
 
-		// Now try to extend this line
-		int index = min_line_len;
-		int len = min_line_len;
+EDLineSplitSink::EDLineSplitSink(double _line_error, int _min_line_len)
+{
+	line_error = _line_error;
+	userMinLineLen = _min_line_len;
+	min_line_len = _min_line_len;
+	width = height = 0;
+}
 
-		while (index < noPixels) {
-			int startIndex = index;
-			int lastGoodIndex = index - 1;
-			int goodPixelCount = 0;
-			int badPixelCount = 0;
-			while (index < noPixels) {
-				double d = ComputeMinDistance(x[index], y[index], lastA, lastB, lastInvert);
+void EDLineSplitSink::begin(int _width, int _height)
+{
+	lines.clear();
+	width = _width;
+	height = _height;
 
-				if (d <= line_error) {
-					lastGoodIndex = index;
-					goodPixelCount++;
-					badPixelCount = 0;
+	min_line_len = userMinLineLen;
+	if (min_line_len == -1) // If no initial value given, compute it
+		min_line_len = EDLines::ComputeMinLineLength(width, height);
 
-				}
-				else {
-					badPixelCount++;
-					if (badPixelCount >= 5) break;
-				} //end-if
+	if (min_line_len < 9) // same lower bound as EDLines
+		min_line_len = 9;
+}
 
-				index++;
-			} //end-while
+void EDLineSplitSink::segment(int segmentNo, EDSegmentView segment)
+{
+	int n = segment.size();
+	if ((int)x.size() < n) {
+		x.resize(n);
+		y.resize(n);
+	} //end-if
 
-			if (goodPixelCount >= 2) {
-				len += lastGoodIndex - startIndex + 1;
-				LineFit(x, y, len, lastA, lastB, lastInvert);  // faster LineFit
-				index = lastGoodIndex + 1;
-			} // end-if
+	for (int k = 0; k < n; k++) {
+		x[k] = segment[k].x;
+		y[k] = segment[k].y;
+	} //end-for
 
-			if (goodPixelCount < 2 || index >= noPixels) {
-				// End of a line segment. Compute the end points
-				double sx, sy, ex, ey;
+	EDLines::SplitSegment2Lines(x.data(), y.data(), n, segmentNo, lines, min_line_len, line_error, true);
+}
 
-				int index = 0;
-				while (ComputeMinDistance(x[index], y[index], lastA, lastB, lastInvert) > line_error) index++;
-				ComputeClosestPoint(x[index], y[index], lastA, lastB, lastInvert, sx, sy);
-				int noSkippedPixels = index;
+const vector<LineSegment> &EDLineSplitSink::getLines()
+{
+	return lines;
+}
 
-				index = lastGoodIndex;
-				while (ComputeMinDistance(x[index], y[index], lastA, lastB, lastInvert) > line_error) index--;
-				ComputeClosestPoint(x[index], y[index], lastA, lastB, lastInvert, ex, ey);
+double EDLineSplitSink::getLineError()
+{
+	return line_error;
+}
 
-				// Add the line segment to lines
-				lines.push_back(LineSegment(lastA, lastB, lastInvert, sx, sy, ex, ey, segmentNo, firstPixelIndex + noSkippedPixels, index - noSkippedPixels + 1));
-				//linesNo++;
-				len = index + 1;
-				break;
-			} //end-else
-		} //end-while
+int EDLineSplitSink::getMinLineLength()
+{
+	return min_line_len;
+}
 
-		noPixels -= len;
-		x += len;
-		y += len;
-		firstPixelIndex += len;
-	} //end-while
+Size EDLineSplitSink::getImageSize()
+{
+	return Size(width, height);
 }
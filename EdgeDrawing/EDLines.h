@@ -60,22 +60,50 @@ struct LineSegment {
 	}
 }; 
 
+class EDLineSplitSink;
 
 class EDLines : public ED {
 public:
-	EDLines(cv::Mat srcImage, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3);
-	EDLines(ED obj, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3);
+	// _quantizedAngles: lines are validated by lookups in a map of gradient angles quantized to 256 bins, computed once for
+	// the whole image, instead of computing the angle of every tested pixel. Pays off when validation covers much of the
+	// image (many & overlapping candidate lines); on sparse images the per-pixel test is cheaper. Alignment is judged at
+	// the bin centres, so lines on the edge of validity may come out differently.
+	EDLines(cv::Mat srcImage, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3, bool _quantizedAngles = false);
+	EDLines(cv::Mat srcImage, const EDRegions &regions, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3, bool _quantizedAngles = false);
+	EDLines(ED obj, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3, bool _quantizedAngles = false);
 	EDLines(EDColor obj, double _line_error = 1.0, int _min_line_len = -1, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3);
+	// Lines of obj from the lines an EDLineSplitSink already split while obj's detection was linking (see
+	// EDDetector::setSegmentSink), so only joining & validation are left; line_error & min_line_len are those of the sink.
+	// An EDAsyncSegmentSink in front of the sink must have been waited for.
+	EDLines(ED obj, EDLineSplitSink &splitSink, double _max_distance_between_two_lines = 6.0, double _max_error = 1.3, bool _quantizedAngles = false);
 	EDLines();
 
 	std::vector<LS> getLines();
 	int getLinesNo();
+
+	// Optional stage after detection: joins collinear lines whose end points are within max_distance_between_two_lines,
+	// whatever segments they come from (e.g. a long edge that ED broke into several segments), with the same test as
+	// the joins of consecutive lines within a segment. Candidates come from a grid of end points, so the cost grows about linearly
+	// with the number of lines. A joined line keeps the segment number of its first part. Returns the number of joins.
+	int joinLinesAcrossSegments();
+
+	// Optional stage after detection: moves every line onto the sub-pixel position of its edge. At every pixel along
+	// the line, gradient magnitudes across it are sampled from the smoothed image (bilinear, searchRange pixels to
+	// either side) and the peak of the profile is located by a parabola; the line is refit to the peaks by orthogonal
+	// regression and its end points are projected onto the fit. Lines without a clear peak on at least half of their
+	// profiles are left as they are. Runs in parallel if ED had a thread pool. Returns the number of lines refined.
+	// The profiles come from the whole smoothed frame in every pipeline: if ED did not keep it (fused pipeline, region &
+	// pyramid modes), the frame is smoothed again first.
+	int refineLinesSubPixel(double searchRange = 2.0);
 	cv::Mat getLineImage();
 	cv::Mat drawOnImage();
 
 	// EDCircle uses this one 
 	static void SplitSegment2Lines(double *x, double *y, int noPixels, int segmentNo, std::vector<LineSegment> &lines, int min_line_len = 6, double line_error = 1.0);
 
+	// Minimum line length from the NFA formula for a width x height image
+	static int ComputeMinLineLength(int width, int height);
+
 private:
 	std::vector<LineSegment> lines;
 	std::vector<LineSegment> invalidLines;
@@ -86,21 +114,44 @@ private:
 	double max_distance_between_two_lines;
 	double max_error;
 	double prec;
-	NFALUT *nfa;
-	
+	std::shared_ptr<const NFALUT> nfa; // see NFALUT::get
+	bool quantizedAngles;
+	cv::Mat angleImage; // quantized gradient angles (see ComputeAngleMap)
+	uchar *angleMap; // angleImage.data if validation uses it, NULL otherwise
 
-	int ComputeMinLineLength();
-	void SplitSegment2Lines(double *x, double *y, int noPixels, int segmentNo);
+	friend class EDLineSplitSink; // splits with dropPointLines, as EDLines does
+
+	static void SplitSegment2Lines(double *x, double *y, int noPixels, int segmentNo, std::vector<LineSegment> &lines, int min_line_len, double line_error, bool dropPointLines);
+	template <class Segments> void SplitSegments(const Segments &segments, EDWorkspace *ws);
+	template <class Segments> void SplitSegments(const Segments &segments, int first, int last, EDWorkspace *ws, std::vector<LineSegment> &segmentLines);
 	void JoinCollinearLines();
 	
-	void ValidateLineSegments();
+	void ValidateLineSegments(EDWorkspace *ws);
+	void ValidateLineSegments(int first, int last, EDWorkspace *ws, char *valid);
+	bool ValidateLineSegment(LineSegment *ls, int *x, int *y, std::vector<cv::Point> &codedPixels);
 	bool ValidateLineSegmentRect(int *x, int *y, LineSegment *ls);
+	void ComputeAngleMap();
+	void AlignedBins(double lineAngle, uchar *aligned);
 	bool TryToJoinTwoLineSegments(LineSegment *ls1, LineSegment *ls2, int changeIndex);
+	bool MayJoin(const LineSegment &ls1, const LineSegment &ls2);
+	int RefineLines(int first, int last, int range, const uchar *img);
 	
 	static double ComputeMinDistance(double x1, double y1, double a, double b, int invert);
 	static void ComputeClosestPoint(double x1, double y1, double a, double b, int invert, double &xOut, double &yOut);
+	// Running sums of the pixels of a line fit. Pixel coordinates are integers, so the sums are exact
+	// and a fit from them equals a fit over the pixels.
+	struct LineFitSums {
+		double S, Sx, Sy, Sxx, Sxy, Syy;
+
+		LineFitSums() : S(0), Sx(0), Sy(0), Sxx(0), Sxy(0), Syy(0) {}
+		void add(double x, double y) { S += 1; Sx += x; Sy += y; Sxx += x*x; Sxy += x*y; Syy += y*y; }
+		void remove(double x, double y) { S -= 1; Sx -= x; Sy -= y; Sxx -= x*x; Sxy -= x*y; Syy -= y*y; }
+	};
+
 	static void LineFit(double *x, double *y, int count, double &a, double &b, int invert);
 	static void LineFit(double *x, double *y, int count, double &a, double &b, double &e, int &invert);
+	static void LineFit(const LineFitSums &sums, double &a, double &b, int invert);
+	static bool FitsLine(double *x, double *y, const LineFitSums &sums, double maxError, double &a, double &b, int &invert);
 	static double ComputeMinDistanceBetweenTwoLines(LineSegment *ls1, LineSegment *ls2, int *pwhich);
 	static void UpdateLineParameters(LineSegment *ls);
 	static void EnumerateRectPoints(double sx, double sy, double ex, double ey,int ptsx[], int ptsy[], int *pNoPoints);
@@ -109,4 +160,30 @@ private:
 	
 };
 
+// Segment sink (see EDSegmentSink) that splits every segment into line segments as soon as ED finalizes it, as
+// EDLines does before validation. Behind an EDAsyncSegmentSink the splitting runs on another thread while ED is still
+// linking. The lines are neither joined nor validated by NFA; EDLines(ED, EDLineSplitSink &) does both.
+class EDLineSplitSink : public EDSegmentSink {
+public:
+	EDLineSplitSink(double _line_error = 1.0, int _min_line_len = -1);
+
+	void begin(int width, int height);
+	void segment(int segmentNo, EDSegmentView segment);
+
+	// Lines of the current detection, in the order of their segments
+	const std::vector<LineSegment> &getLines();
+
+	double getLineError();
+	int getMinLineLength(); // of the current detection
+	cv::Size getImageSize(); // of the current detection
+
+private:
+	std::vector<LineSegment> lines;
+	std::vector<double> x, y;
+	int userMinLineLen;
+	int min_line_len;
+	double line_error;
+	int width, height;
+};
+
 #endif 
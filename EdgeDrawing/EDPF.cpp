@@ -6,19 +6,39 @@ using namespace std;
 EDPF::EDPF(Mat srcImage)
 	:ED(srcImage, PREWITT_OPERATOR, 11, 3)
 {
+	ConvertTo8Bit(); // validation works on 8-bit pixels
+
 	// Validate Edge Segments
 	sigma /= 2.5;
-	GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+	if (regionRects.empty())
+		GaussianBlur(this->srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+	else
+		SmoothRegions(Size(), sigma, 1);
+	smoothImg = smoothImage.data; // smoothImage is (re)allocated if the fused pipeline did not keep it
 	
 	validateEdgeSegments();
 }
 
+// Edge segments inside the given regions only (see EDRegions)
+EDPF::EDPF(Mat srcImage, const EDRegions &regions)
+	:EDPF(ED(srcImage, regions, PREWITT_OPERATOR, 11, 3))
+{
+}
+
 EDPF::EDPF(ED obj)
-	:ED(obj)
+	:ED(std::move(obj))
 {
+	ConvertTo8Bit(); // validation works on 8-bit pixels (EDCircles as well)
+	if (segmentPoints.empty() && !chainCodes.empty()) segmentPoints = chainCodes.decode(); // chain code output only
+
 	// Validate Edge Segments
 	sigma /= 2.5;
-	GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+	smoothImage.release(); // shared with obj: smooth into a new image
+	if (regionRects.empty())
+		GaussianBlur(srcImage, smoothImage, Size(), sigma); // calculate kernel from sigma
+	else
+		SmoothRegions(Size(), sigma, 1);
+	smoothImg = smoothImage.data; // smoothImage is (re)allocated if the fused pipeline did not keep it
 
 	validateEdgeSegments();
 }
@@ -31,7 +51,7 @@ EDPF::EDPF(EDColor obj)
 void EDPF::validateEdgeSegments()
 {
 	divForTestSegment = 2.25; // Some magic number :-)
-	memset(edgeImg, 0, width*height); // clear edge image
+	DetachEdgeImage(); // clear edge image
 	
 	H = new double[MAX_GRAD_VALUE];
 	memset(H, 0, sizeof(double)*MAX_GRAD_VALUE);
@@ -78,42 +98,51 @@ short * EDPF::ComputePrewitt3x3()
 	int *grads = new int[MAX_GRAD_VALUE];
 	memset(grads, 0, sizeof(int)*MAX_GRAD_VALUE);
 
-	for (int i = 1; i<height - 1; i++) {
-		for (int j = 1; j<width - 1; j++) {
-			// Prewitt Operator in horizontal and vertical direction
-			// A B C
-			// D x E
-			// F G H
-			// gx = (C-A) + (E-D) + (H-F)
-			// gy = (F-A) + (G-B) + (H-C)
-			//
-			// To make this faster: 
-			// com1 = (H-A)
-			// com2 = (C-F)
-			// Then: gx = com1 + com2 + (E-D) = (H-A) + (C-F) + (E-D) = (C-A) + (E-D) + (H-F)
-			//       gy = com1 - com2 + (G-B) = (H-A) - (C-F) + (G-B) = (F-A) + (G-B) + (H-C)
-			// 
-			int com1 = smoothImg[(i + 1)*width + j + 1] - smoothImg[(i - 1)*width + j - 1];
-			int com2 = smoothImg[(i - 1)*width + j + 1] - smoothImg[(i + 1)*width + j - 1];
-
-			int gx = abs(com1 + com2 + (smoothImg[i*width + j + 1] - smoothImg[i*width + j - 1]));
-			int gy = abs(com1 - com2 + (smoothImg[(i + 1)*width + j] - smoothImg[(i - 1)*width + j]));
-
-			int g = gx + gy;
-
-			gradImg[i*width + j] = g;
-			grads[g]++;
-		} // end-for
+	// Restricted to regions, only their pixels are differentiated & counted in H
+	std::vector<Rect> rects = regionRects;
+	if (rects.empty()) rects.push_back(Rect(0, 0, width, height));
+
+	int size = 0;
+	for (size_t k = 0; k < rects.size(); k++) {
+		Rect area = rects[k] & Rect(1, 1, width - 2, height - 2);
+		for (int i = area.y; i<area.y + area.height; i++) {
+			for (int j = area.x; j<area.x + area.width; j++) {
+				if (!regions.mask.empty() && regions.mask.at<uchar>(i, j) == 0) continue;
+
+				// Prewitt Operator in horizontal and vertical direction
+				// A B C
+				// D x E
+				// F G H
+				// gx = (C-A) + (E-D) + (H-F)
+				// gy = (F-A) + (G-B) + (H-C)
+				//
+				// To make this faster: 
+				// com1 = (H-A)
+				// com2 = (C-F)
+				// Then: gx = com1 + com2 + (E-D) = (H-A) + (C-F) + (E-D) = (C-A) + (E-D) + (H-F)
+				//       gy = com1 - com2 + (G-B) = (H-A) - (C-F) + (G-B) = (F-A) + (G-B) + (H-C)
+				// 
+				int com1 = smoothImg[(i + 1)*width + j + 1] - smoothImg[(i - 1)*width + j - 1];
+				int com2 = smoothImg[(i - 1)*width + j + 1] - smoothImg[(i + 1)*width + j - 1];
+
+				int gx = abs(com1 + com2 + (smoothImg[i*width + j + 1] - smoothImg[i*width + j - 1]));
+				int gy = abs(com1 - com2 + (smoothImg[(i + 1)*width + j] - smoothImg[(i - 1)*width + j]));
+
+				int g = gx + gy;
+
+				gradImg[i*width + j] = g;
+				grads[g]++;
+				size++;
+			} // end-for
+		} //end-for
 	} //end-for
 
 	 // Compute probability function H
-	int size = (width - 2)*(height - 2);
-	
 	for (int i = MAX_GRAD_VALUE - 1; i>0; i--)
 		grads[i - 1] += grads[i];
 	
 	for (int i = 0; i < MAX_GRAD_VALUE; i++)
-		H[i] = (double)grads[i] / ((double)size);
+		H[i] = (double)grads[i] / ((double)MAX(size, 1));
 
 	delete[] grads;
 	return gradImg;
@@ -186,7 +215,7 @@ void EDPF::TestSegment(int i, int index1, int index2)
 void EDPF::ExtractNewSegments()
 {
 	//vector<Point> *segments = &segmentPoints[segmentNos];
-	vector< vector<Point> > validSegments;
+	EDSegments validSegments;
 	int noSegments = 0;
 
 	for (int i = 0; i < segmentNos; i++) {
@@ -215,9 +244,7 @@ void EDPF::ExtractNewSegments()
 				// A new segment. Accepted only only long enough (whatever that means)
 				//segments[noSegments].pixels = &map->segments[i].pixels[start];
 				//segments[noSegments].noPixels = len;
-				validSegments.push_back(vector<Point>());
-				vector<Point> subVec(&segmentPoints[i][start], &segmentPoints[i][end - 1]);
-				validSegments[noSegments] = subVec;
+				validSegments.append(segmentPoints[i], start, end - 1);
 				noSegments++;
 			} //end-else
 
@@ -226,7 +253,7 @@ void EDPF::ExtractNewSegments()
 	} //end-for
 
 	 // Copy to ed
-	segmentPoints = validSegments;
+	segmentPoints = std::move(validSegments);
 
 	segmentNos = noSegments;
 }
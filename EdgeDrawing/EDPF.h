@@ -21,6 +21,7 @@
 class EDPF : public ED {
 public:
 	EDPF(cv::Mat srcImage);
+	EDPF(cv::Mat srcImage, const EDRegions &regions);
 	EDPF(ED obj);
 	EDPF(EDColor obj);
 private:
@@ -0,0 +1,97 @@
+#include "EDSegmentSink.h"
+
+using namespace cv;
+using namespace std;
+
+EDAsyncSegmentSink::EDAsyncSegmentSink(EDSegmentSink *_target)
+{
+	target = _target;
+	busy = false;
+	stop = false;
+	worker = thread(&EDAsyncSegmentSink::Run, this);
+}
+
+EDAsyncSegmentSink::~EDAsyncSegmentSink()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stop = true;
+	}
+	queued.notify_one();
+	worker.join();
+}
+
+void EDAsyncSegmentSink::begin(int width, int height)
+{
+	Push(SINK_BEGIN, width, height);
+}
+
+void EDAsyncSegmentSink::segment(int segmentNo, EDSegmentView segment)
+{
+	Push(SINK_SEGMENT, segmentNo, 0, segment);
+}
+
+void EDAsyncSegmentSink::end(int noSegments)
+{
+	Push(SINK_END, noSegments, 0);
+}
+
+void EDAsyncSegmentSink::wait()
+{
+	unique_lock<mutex> guard(lock);
+	drained.wait(guard, [this] { return queue.empty() && !busy; });
+
+	if (error) {
+		exception_ptr e = error;
+		error = nullptr;
+		rethrow_exception(e);
+	} //end-if
+}
+
+void EDAsyncSegmentSink::Push(EventType type, int a, int b, EDSegmentView segment)
+{
+	Event event;
+	event.type = type;
+	event.a = a;
+	event.b = b;
+	event.pixels.assign(segment.begin(), segment.end());
+
+	{
+		unique_lock<mutex> guard(lock);
+		queue.push_back(std::move(event));
+	}
+	queued.notify_one();
+}
+
+// Replays the queue to target until the sink is destroyed (events queued by then are still delivered)
+void EDAsyncSegmentSink::Run()
+{
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		queued.wait(guard, [this] { return stop || !queue.empty(); });
+		if (queue.empty()) break;
+
+		Event event = std::move(queue.front());
+		queue.pop_front();
+		busy = true;
+		guard.unlock();
+
+		try {
+			if (event.type == SINK_BEGIN)
+				target->begin(event.a, event.b);
+			else if (event.type == SINK_SEGMENT)
+				target->segment(event.a, EDSegmentView(event.pixels.data(), (int)event.pixels.size()));
+			else
+				target->end(event.a);
+		}
+		catch (...) {
+			guard.lock();
+			if (!error) error = current_exception();
+			guard.unlock();
+		} //end-catch
+
+		guard.lock();
+		busy = false;
+		if (queue.empty()) drained.notify_all();
+	} //end-while
+}
@@ -0,0 +1,70 @@
+/**************************************************************************************************************
+* Streaming of edge segments.
+*
+* An EDSegmentSink attached to ED (EDDetector::setSegmentSink) receives every segment as soon as linking
+* finalizes it, so a consumer (e.g. EDLineSplitSink) can start on the first segments while ED is still linking.
+* EDAsyncSegmentSink forwards the segments to another sink on a thread of its own.
+**************************************************************************************************************/
+
+#ifndef _EDSegmentSink_
+#define _EDSegmentSink_
+
+#include "EDSegments.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+// Callbacks of one detection: begin, then segment for segmentNo = 0, 1, ... in the order of getSegmentList(), then end.
+// They are called on the detecting thread; the view is only valid during the call.
+class EDSegmentSink {
+public:
+	virtual ~EDSegmentSink() {}
+
+	virtual void begin(int /*width*/, int /*height*/) {}
+	virtual void segment(int segmentNo, EDSegmentView segment) = 0;
+	virtual void end(int /*noSegments*/) {}
+};
+
+// Copies the events into a queue and replays them to target on its own thread, so that the detection does not wait
+// for the consumer. The target is not owned and must outlive the sink.
+class EDAsyncSegmentSink : public EDSegmentSink {
+public:
+	EDAsyncSegmentSink(EDSegmentSink *_target);
+	~EDAsyncSegmentSink(); // waits for the queued events
+
+	void begin(int width, int height);
+	void segment(int segmentNo, EDSegmentView segment);
+	void end(int noSegments);
+
+	// Waits until target received all events so far; rethrows the first exception target threw since the last wait
+	void wait();
+
+private:
+	EDAsyncSegmentSink(const EDAsyncSegmentSink &) = delete;
+	EDAsyncSegmentSink &operator=(const EDAsyncSegmentSink &) = delete;
+
+	enum EventType { SINK_BEGIN, SINK_SEGMENT, SINK_END };
+
+	struct Event {
+		EventType type;
+		int a, b; // width & height, segmentNo, noSegments
+		std::vector<cv::Point> pixels;
+	};
+
+	void Push(EventType type, int a, int b, EDSegmentView segment = EDSegmentView());
+	void Run();
+
+	EDSegmentSink *target;
+	std::deque<Event> queue;
+	bool busy; // the thread is replaying an event
+	bool stop;
+	std::exception_ptr error;
+	std::mutex lock;
+	std::condition_variable queued;
+	std::condition_variable drained;
+	std::thread worker;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/**************************************************************************************************************
+* Flat storage of edge segments.
+*
+* All segment pixels live in one contiguous array; segment i is points[offsets[i] ... offsets[i+1]).
+* Segments are read through EDSegmentView, a lightweight (pointer, length) view, so consumers can
+* walk the segments without any per-segment allocation or copying.
+*
+* While segments are being built (edge linking), the pixels after the last closed segment form an
+* "open" segment that can be grown, trimmed and finally closed or discarded.
+**************************************************************************************************************/
+
+#ifndef _EDSegments_
+#define _EDSegments_
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Read-only view of the pixels of one segment
+struct EDSegmentView {
+	const cv::Point *pixels;
+	int len;
+
+	EDSegmentView() : pixels(NULL), len(0) {}
+	EDSegmentView(const cv::Point *_pixels, int _len) : pixels(_pixels), len(_len) {}
+
+	int size() const { return len; }
+	bool empty() const { return len == 0; }
+	const cv::Point &operator[](int i) const { return pixels[i]; }
+	const cv::Point *begin() const { return pixels; }
+	const cv::Point *end() const { return pixels + len; }
+	const cv::Point &front() const { return pixels[0]; }
+	const cv::Point &back() const { return pixels[len - 1]; }
+
+	std::vector<cv::Point> toVector() const { return std::vector<cv::Point>(pixels, pixels + len); }
+};
+
+class EDSegments {
+public:
+	EDSegments() { offsets.push_back(0); }
+	EDSegments(const std::vector<std::vector<cv::Point>> &segments) { offsets.push_back(0); assign(segments); }
+
+	// Number of (closed) segments
+	int size() const { return (int)offsets.size() - 1; }
+	bool empty() const { return size() == 0; }
+
+	// Segment i; i == size() gives the open segment
+	EDSegmentView operator[](int i) const {
+		int start = offsets[i];
+		int stop = i + 1 < (int)offsets.size() ? offsets[i + 1] : (int)points.size();
+		return EDSegmentView(points.data() + start, stop - start);
+	}
+
+	// Raw CSR arrays: size()+1 offsets into totalPoints() pixels
+	const cv::Point *data() const { return points.data(); }
+	const int *getOffsets() const { return offsets.data(); }
+	int totalPoints() const { return offsets.back(); }
+
+	void clear() { points.clear(); offsets.resize(1); }
+	void reserve(int noPoints, int noSegments) { points.reserve(noPoints); offsets.reserve(noSegments + 1); }
+
+	// Building the open segment
+	void addPoint(const cv::Point &p) { points.push_back(p); }
+	void removeLastPoint() { points.pop_back(); }
+	void removeFirstPoint() { points.erase(points.begin() + offsets.back()); }
+	int openSize() const { return (int)points.size() - offsets.back(); }
+	void closeSegment() { offsets.push_back((int)points.size()); }
+	void discardOpen() { points.resize(offsets.back()); }
+
+	// Appends pixels [start, end) of a segment as a new closed segment
+	void append(EDSegmentView segment, int start, int end) {
+		points.insert(points.end(), segment.pixels + start, segment.pixels + end);
+		closeSegment();
+	}
+	void append(EDSegmentView segment) { append(segment, 0, segment.len); }
+
+	void assign(const std::vector<std::vector<cv::Point>> &segments) {
+		clear();
+		for (int i = 0; i < (int)segments.size(); i++) {
+			points.insert(points.end(), segments[i].begin(), segments[i].end());
+			closeSegment();
+		} //end-for
+	}
+
+	std::vector<std::vector<cv::Point>> toVectors() const {
+		std::vector<std::vector<cv::Point>> segments(size());
+		for (int i = 0; i < size(); i++) segments[i].assign(points.begin() + offsets[i], points.begin() + offsets[i + 1]);
+		return segments;
+	}
+
+private:
+	std::vector<cv::Point> points;
+	std::vector<int> offsets;
+};
+
+#endif
@@ -1,6 +1,10 @@
 #include "NFA.h"
 #include <math.h>
 #include <float.h>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 NFALUT::NFALUT(int size, double _prob, double _logNT)
 {
@@ -35,7 +39,27 @@ NFALUT::~NFALUT()
 	delete[] LUT;
 }
 
-bool NFALUT::checkValidationByNFA(int n, int k)
+std::shared_ptr<const NFALUT> NFALUT::get(int size, double prob, double logNT)
+{
+	typedef std::tuple<int, double, double> Key;
+	static std::mutex lock;
+	static std::map<Key, std::shared_ptr<const NFALUT>> cache;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	Key key(size, prob, logNT);
+	auto it = cache.find(key);
+	if (it != cache.end()) return it->second;
+
+	// A process sees few image sizes; should it see many, start over (tables in use stay alive)
+	if (cache.size() >= 64) cache.clear();
+
+	std::shared_ptr<const NFALUT> table = std::make_shared<const NFALUT>(size, prob, logNT);
+	cache[key] = table;
+	return table;
+}
+
+bool NFALUT::checkValidationByNFA(int n, int k) const
 {
 	if (n >= LUTSize)
 		return nfa(n, k) >= 0.0;
@@ -45,15 +69,14 @@ bool NFALUT::checkValidationByNFA(int n, int k)
 
 double NFALUT::myAtan2(double yy, double xx)
 {
-	static double LUT[MAX_LUT_SIZE + 1];
-	static bool tableInited = false;
-	if (!tableInited) {
+	// Built once on first use; initialization of a local static is thread-safe
+	static const std::vector<double> LUT = [] {
+		std::vector<double> table(MAX_LUT_SIZE + 1);
 		for (int i = 0; i <= MAX_LUT_SIZE; i++) {
-			LUT[i] = atan((double)i / MAX_LUT_SIZE);
+			table[i] = atan((double)i / MAX_LUT_SIZE);
 		} //end-for
-
-		tableInited = true;
-	} //end-if
+		return table;
+	}();
 
 	double y = fabs(yy);
 	double x = fabs(xx);
@@ -103,9 +126,14 @@ double NFALUT::myAtan2(double yy, double xx)
 	return angle;
 }
 
-double NFALUT::nfa(int n, int k)
+double NFALUT::nfa(int n, int k) const
 {
-	static double inv[TABSIZE];   /* table to keep computed inverse values */
+	/* table of inverse values 1/i, computed once (thread-safe initialization of a local static) */
+	static const std::vector<double> inv = [] {
+		std::vector<double> table(TABSIZE, 0.0);
+		for (int i = 1; i < TABSIZE; i++) table[i] = 1.0 / (double)i;
+		return table;
+	}();
 	double tolerance = 0.1;       /* an error of 10% in the result is accepted */
 	double log1term, term, bin_term, mult_term, bin_tail, err, p_term;
 	int i;
@@ -153,13 +181,11 @@ double NFALUT::nfa(int n, int k)
 		term_i / term_i-1 = (n-i+1)/i * p/(1-p)
 		and
 		term_i = term_i-1 * (n-i+1)/i * p/(1-p).
-		1/i is stored in a table as they are computed,
+		1/i is taken from a table computed once,
 		because divisions are expensive.
 		p/(1-p) is computed only once and stored in 'p_term'.
 		*/
-		bin_term = (double)(n - i + 1) * (i<TABSIZE ?
-			(inv[i] != 0.0 ? inv[i] : (inv[i] = 1.0 / (double)i)) :
-			1.0 / (double)i);
+		bin_term = (double)(n - i + 1) * (i<TABSIZE ? inv[i] : 1.0 / (double)i);
 
 		mult_term = bin_term * p_term;
 		term *= mult_term;
@@ -24,24 +24,35 @@
 
 #define RELATIVE_ERROR_FACTOR 100.0
 
+#include <memory>
+
 // Lookup table (LUT) for NFA computation
+// A table is never changed after construction, so one table may be used by any number of threads;
+// all static tables are built once, on first use, and are read-only afterwards.
 class NFALUT {
 public:
 
 	NFALUT(int size, double _prob, double _logNT);
 	~NFALUT();
 
+	// Process-wide cache: the table for (size, prob, logNT), built on the first request & shared by all
+	// later ones (e.g. every frame of a video and every thread). Safe to call from any thread.
+	static std::shared_ptr<const NFALUT> get(int size, double prob, double logNT);
+
 	int *LUT; // look up table
 	int LUTSize;
 
 	double prob;
 	double logNT;
 
-	bool checkValidationByNFA(int n, int k);
+	bool checkValidationByNFA(int n, int k) const;
 	static double myAtan2(double yy, double xx);
 
 private:
-	double nfa(int n, int k);
+	NFALUT(const NFALUT &) = delete;
+	NFALUT &operator=(const NFALUT &) = delete;
+
+	double nfa(int n, int k) const;
 	static double log_gamma_lanczos(double x);
 	static double log_gamma_windschitl(double x);
 	static double log_gamma(double x);
@@ -16,6 +16,7 @@ int main(int argc, const char** argv)
         "{scale|1|}"
         "{counter|99999|}"
         "{show|false|}"
+        "{incremental|false|}"
         "{@filename|vtest.avi|}"
     );
 
@@ -23,6 +24,7 @@ int main(int argc, const char** argv)
     double scale = parser.get<double>("scale");
     int test_counter = parser.get<int>("counter");
     bool show = parser.get<bool>("show");
+    bool incremental = parser.get<bool>("incremental");
     Mat src, gray;
     TickMeter tm0, tm1;
     int counter = 0;
@@ -42,6 +44,12 @@ int main(int argc, const char** argv)
         vector<Vec6d> ellipses;
         vector<Vec4f> lines;
 
+        // Scratch buffers are allocated once and reused for every frame
+        EDDetector testED(SOBEL_OPERATOR, 36, 8, 1, 10, 1.0, true);
+        if (incremental)
+            testED.setIncremental(true); // static camera: only changed tiles are detected again
+        double reuseSum = 0;
+
         for (;;)
         {
             capture >> src;
@@ -61,10 +69,11 @@ int main(int argc, const char** argv)
             counter++;
 
             tm1.start();
-            ED testED = ED(gray, SOBEL_OPERATOR, 36, 8, 1, 10, 1.0, true);
+            testED.detect(gray);
             EDLines testEDLines = EDLines(testED);
             EDCircles testEDCircles = EDCircles(testEDLines);
             tm1.stop();
+            reuseSum += testED.getIncrementalStats().reuseRatio;
 
             if (show)
             {
@@ -91,6 +100,9 @@ int main(int argc, const char** argv)
 
         cout << "EDCircles processed " << counter << " frames in    " << tm1.getTimeMilli() << " ms.";
         cout << "\t\tfps : " << counter * 1000 / tm1.getTimeMilli() << endl;
+
+        if (incremental && counter > 0)
+            cout << "Incremental mode reused " << 100 * reuseSum / counter << "% of the frame area on average" << endl;
     }
     return 0;
 }